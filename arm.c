@@ -51,6 +51,16 @@ int int_enabled ()
     return !(val & DIS_INT);
 }
 
+// wait for interrupt: put the core in low-power standby until an
+// interrupt is pending. It wakes up even if interrupts are disabled
+// in cpsr, the interrupt is then taken once they are enabled.
+void wfi (void)
+{
+    uint val = 0;
+
+    asm volatile("MCR p15, 0, %[r], c7, c0, 4": :[r]"r" (val):"memory");
+}
+
 // Pushcli/popcli are like cli/sti except that they are matched:
 // it takes two popcli to undo two pushcli.  Also, if interrupts
 // are off, then pushcli, popcli leaves them off.
@@ -63,8 +73,8 @@ void pushcli (void)
 
     cli();
 
-    if (cpu->ncli++ == 0) {
-        cpu->intena = enabled;
+    if (mycpu()->ncli++ == 0) {
+        mycpu()->intena = enabled;
     }
 }
 
@@ -74,12 +84,12 @@ void popcli (void)
         panic("popcli - interruptible");
     }
 
-    if (--cpu->ncli < 0) {
-        cprintf("cpu (%d)->ncli: %d\n", cpu, cpu->ncli);
+    if (--mycpu()->ncli < 0) {
+        cprintf("cpu (%d)->ncli: %d\n", mycpu(), mycpu()->ncli);
         panic("popcli -- ncli < 0");
     }
 
-    if ((cpu->ncli == 0) && cpu->intena) {
+    if ((mycpu()->ncli == 0) && mycpu()->intena) {
         sti();
     }
 }
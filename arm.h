@@ -1,7 +1,11 @@
 #ifndef ARM_INCLUDE
 #define ARM_INCLUDE
 
+#ifdef BOARD_REALVIEW
+#include "device/realview_eb.h"
+#else
 #include "device/versatile_pb.h"
+#endif
 
 // trap frame: in ARM, there are seven modes. Among the 16 regular registers,
 // r13 (sp), r14(lr), r15(pc) are banked in all modes.
@@ -1,10 +1,10 @@
 /*----------xv6 sync lab----------*/
 #include "types.h"
 #include "arm.h"
+#include "param.h"
 #include "spinlock.h"
 #include "defs.h"
 #include "barrier.h"
-#include "param.h"
 #include "proc.h"
 //define any variables needed here
 
@@ -139,7 +139,7 @@ void panic(char *s)
 
     cons.locking = 0;
 
-    cprintf("cpu%d: panic: ", cpu->id);
+    cprintf("cpu%d: panic: ", mycpu()->id);
 
     show_callstk(s);
     panicked = 1; // freeze other CPU
@@ -284,7 +284,7 @@ int consoleread(struct inode *ip, char *dst, int n)
     {
         while (input.r == input.w)
         {
-            if (proc->killed)
+            if (myproc()->killed)
             {
                 release(&input.lock);
                 ilock(ip);
@@ -32,6 +32,7 @@ void cli(void);
 void sti(void);
 uint spsr_usr();
 int int_enabled();
+void wfi(void);
 void pushcli(void);
 void popcli(void);
 void getcallerpcs(void *, uint *);
@@ -108,10 +109,17 @@ void log_write(struct buf *);
 void begin_trans();
 void commit_trans();
 
-// picirq.c
+// picirq.c or gic.c
 void pic_enable(int, ISR);
 void pic_init(void *);
 void pic_dispatch(struct trapframe *tp);
+void pic_cpuinit(void);
+void pic_sendipi(int);
+void pic_sendipi_to(int, int);
+
+// mpcore.c
+int mpcore_init(void);
+void mpcore_boot(uint entry);
 
 // pipe.c
 int pipealloc(struct file **, struct file **);
@@ -123,24 +131,39 @@ int pipewrite(struct pipe *, char *, int);
 //  proc.c
 struct proc *copyproc(struct proc *);
 void exit(void);
+void thread_exit(void);
 int fork(void);
 int growproc(int);
 int kill(int);
 void pinit(void);
+void runq_init(int);
 void procdump(void);
 void scheduler(void) __attribute__((noreturn));
 void sched(void);
 void sleep(void *, struct spinlock *);
+void sleeplend(void *, struct spinlock *, int);
 void userinit(void);
 int wait(void);
+int waitpid(int pid);
 void wakeup(void *);
+void wakeupone(void *);
+int sleepfor(int n);
+void timer_expire(uint now);
 void yield(void);
 int ps(void);
 int setticks(int pid, int n);
 void srand(uint seed);
+uint rand(void);
 struct pstat;
-int getpinfo(struct pstat *ps);
-struct proc *hold_lottery(int total_tickets);
+int getpinfo(uint uva, int n);
+int setsched(int pid, int policy);
+int setrt(int runtime, int period, int deadline);
+int creategroup(int funding);
+int fundgroup(int id, int funding);
+int setgroup(int pid, int id);
+int setgang(int on);
+int setquota(int id, int quota, int period);
+int yield_to(int pid);
 
 // swtch.S
 void swtch(struct context **, struct context *);
@@ -170,11 +193,15 @@ void syscall(void);
 
 // timer.c
 void timer_init(int hz);
+void timer_idle(int nticks);
+void timer_resume(void);
+uint timer_usec(void);
 extern struct spinlock tickslock;
 
 // trap.c
 extern uint ticks;
 void trap_init(void);
+void trap_stack_init(void);
 void dump_trapframe(struct trapframe *tf);
 
 // trap_asm.S
@@ -202,6 +229,11 @@ void inituvm(pde_t *, char *, uint);
 int loaduvm(pde_t *, char *, struct inode *, uint, uint);
 pde_t *copyuvm(pde_t *, uint);
 void switchuvm(struct proc *);
+void flushuvm(struct proc *);
+void flushupage(struct proc *, uint);
+void flushurange(struct proc *, uint, uint);
+int shrinkuvm(struct proc *, uint, uint);
+void tlb_init(void);
 int copyout(pde_t *, uint, void *, uint);
 void clearpteu(pde_t *pgdir, char *uva);
 void *kpt_alloc(void);
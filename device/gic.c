@@ -0,0 +1,161 @@
+// Support of the ARM11 MPCore interrupt controller (GIC)
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "arm.h"
+#include "memlayout.h"
+#include "mmu.h"
+
+// The GIC has one interrupt distributor, shared by all the cores, and a
+// CPU interface per core (at the same address on each core, banked).
+// The distributor routes the board interrupts to core 0 only. The flow
+// to handle an interrupt is as the following:
+//		1. an interrupt (IRQ) occurs, trap.c branches to our IRQ handler
+//		2. read GICC_IAR to acknowledge the highest priority pending
+//		   interrupt, which also tells its ID:
+//			2.1 locate the correct ISR
+//			2.2 execute the ISR
+//			2.3 write the ID back to GICC_EOIR to end the interrupt
+//		3. repeat until GICC_IAR reports a spurious interrupt, then
+//		   return to trap.c, which will resume interrupted routines
+
+// offsets of the GIC in the MPCore private memory region
+#define GIC_CPU_OFF		0x0100
+#define GIC_DIST_OFF	0x1000
+
+// distributor registers (in the unit of 4 bytes)
+#define GICD_CTLR		(0x000/4) // enable forwarding to the CPU interfaces
+#define GICD_ISENABLER	(0x100/4) // enable interrupts (1 - enable it)
+#define GICD_ICENABLER	(0x180/4) // disable interrupts (1 - disable it)
+#define GICD_SGIR		(0xF00/4) // send a software interrupt
+
+// byte registers, one byte per interrupt
+#define GICD_IPRIORITYR	0x400	  // priority (lower is more urgent)
+#define GICD_ITARGETSR	0x800	  // cores to deliver to (bit n - core n)
+
+// CPU interface registers (in the unit of 4 bytes)
+#define GICC_CTLR		0 // enable signalling interrupts to the core
+#define GICC_PMR		1 // priority mask, only more urgent ones pass
+#define GICC_IAR		3 // acknowledge, read the pending interrupt ID
+#define GICC_EOIR		4 // end of interrupt
+
+#define GIC_SPURIOUS	1023 // nothing pending
+#define GIC_NSGI		16	 // 0-15 are software interrupts
+#define GIC_FIRST_SPI	32	 // shared (board) interrupts start here
+
+#define SGI_OTHERS		(1 << 24) // SGIR filter: all but the sender
+#define SGI_TARGET(c)	(1 << (16 + (c))) // SGIR target list: core c
+
+static volatile uint* gicd;
+static volatile uint* gicc;
+
+static ISR isrs[PIC_NIRQ];
+
+static void default_isr (struct trapframe *tf, int n)
+{
+    cprintf ("unhandled interrupt: %d\n", n);
+}
+
+// software interrupts only get the core out of wfi or back into the
+// kernel, irq_handler does the rest
+static void sgi_isr (struct trapframe *tf, int n)
+{
+}
+
+// initialize the distributor and the CPU interface of the boot core.
+// base is the MPCore private memory region.
+void pic_init (void * base)
+{
+    volatile uchar *regs;
+    int i;
+
+    gicd = (uint*)((uint)base + GIC_DIST_OFF);
+    gicc = (uint*)((uint)base + GIC_CPU_OFF);
+
+    gicd[GICD_CTLR] = 0;
+
+    for (i = 0; i < PIC_NIRQ / 32; i++) {
+        gicd[GICD_ICENABLER + i] = 0xFFFFFFFF;
+    }
+
+    // all at the same priority, board interrupts go to core 0
+    regs = (uchar*)gicd;
+
+    for (i = 0; i < PIC_NIRQ; i++) {
+        regs[GICD_IPRIORITYR + i] = 0xA0;
+
+        if (i >= GIC_FIRST_SPI) {
+            regs[GICD_ITARGETSR + i] = 0x01;
+        }
+
+        isrs[i] = (i < GIC_NSGI) ? sgi_isr : default_isr;
+    }
+
+    gicd[GICD_CTLR] = 1;
+
+    pic_cpuinit ();
+}
+
+// enable the CPU interface of the calling core
+void pic_cpuinit (void)
+{
+    gicc[GICC_PMR] = 0xF0;
+    gicc[GICC_CTLR] = 1;
+}
+
+// enable an interrupt (with the ISR)
+void pic_enable (int n, ISR isr)
+{
+    if ((n<0) || (n >= PIC_NIRQ)) {
+        panic ("invalid interrupt source");
+    }
+
+    // write 1 bit enable the interrupt, 0 bit has no effect
+    isrs[n] = isr;
+    gicd[GICD_ISENABLER + n / 32] = (1 << (n % 32));
+}
+
+// disable an interrupt
+void pic_disable (int n)
+{
+    if ((n<0) || (n >= PIC_NIRQ)) {
+        panic ("invalid interrupt source");
+    }
+
+    gicd[GICD_ICENABLER + n / 32] = (1 << (n % 32));
+    isrs[n] = (n < GIC_NSGI) ? sgi_isr : default_isr;
+}
+
+// send software interrupt n to all the other cores
+void pic_sendipi (int n)
+{
+    gicd[GICD_SGIR] = SGI_OTHERS | n;
+}
+
+// send software interrupt n to core c only
+void pic_sendipi_to (int n, int c)
+{
+    gicd[GICD_SGIR] = SGI_TARGET(c) | n;
+}
+
+// dispatch the interrupt
+void pic_dispatch (struct trapframe *tp)
+{
+    uint iar;
+    int id;
+
+    for (;;) {
+        iar = gicc[GICC_IAR];
+        id = iar & 0x3FF;
+
+        if (id == GIC_SPURIOUS) {
+            break;
+        }
+
+        if (id < PIC_NIRQ) {
+            isrs[id](tp, id);
+        }
+
+        gicc[GICC_EOIR] = iar;
+    }
+}
@@ -0,0 +1,43 @@
+// ARM11 MPCore support: the snoop control unit and the secondary cores
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "arm.h"
+#include "memlayout.h"
+#include "mmu.h"
+
+// snoop control unit registers (in the unit of 4 bytes), at the start
+// of the MPCore private memory region
+#define SCU_CONTROL		0 // bit 0: enable the SCU (cache coherency)
+#define SCU_CONFIG		1 // bits 1:0: number of cores - 1
+
+// enable the SCU so that the caches of the cores are kept coherent,
+// return the number of cores
+int mpcore_init (void)
+{
+    volatile uint *scu = P2V(MPCORE_BASE);
+
+    scu[SCU_CONTROL] |= 0x01;
+
+    return (scu[SCU_CONFIG] & 0x03) + 1;
+}
+
+// start the secondary cores at entry, a physical address. The boot
+// loader parks them in wfi, each polling SYS_FLAGS for an address to
+// jump to whenever it wakes up.
+void mpcore_boot (uint entry)
+{
+    volatile uint *flagsclr = P2V(SYS_FLAGSCLR);
+    volatile uint *flagsset = P2V(SYS_FLAGSSET);
+    uint val = 0;
+
+    *flagsclr = 0xFFFFFFFF;
+    *flagsset = entry;
+
+    // they start with the MMU and caches off: write back the page tables
+    // and everything else they read before paging is on
+    asm("MCR p15, 0, %[r], c7, c10, 0": :[r]"r" (val):"memory");
+    asm("MCR p15, 0, %[r], c7, c10, 4": :[r]"r" (val):"memory");
+
+    pic_sendipi (IPI_TICK);
+}
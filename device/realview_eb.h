@@ -0,0 +1,48 @@
+//
+// Board specific information for the RealView Emulation Baseboard with
+// an ARM11 MPCore tile (QEMU's realview-eb-mpcore)
+//
+#ifndef REALVIEWEB
+#define REALVIEWEB
+
+
+// the board has 256MB of SDRAM at 0, we assume 128MB as on the VersatilePB
+#define PHYSTOP         0x08000000
+
+#define DEVBASE         0x10000000
+#define DEV_MEM_SZ      0x08000000
+#define VEC_TBL         0xFFFF0000
+
+
+#define STACK_FILL      0xdeadbeef
+
+#define UART0           0x10009000
+#define UART_CLK        24000000    // Clock rate for UART
+
+#define TIMER0          0x10011000
+#define TIMER1          0x10011020
+#define CLK_HZ          1000000     // the clock is 1MHZ
+
+// the secondary cores spin on SYS_FLAGS until it holds an address to
+// jump to. Writing to SET/CLR sets/clears bits in it.
+#define SYS_FLAGSSET    0x10000030
+#define SYS_FLAGSCLR    0x10000034
+
+// private memory region of the MPCore: the snoop control unit, the GIC
+// CPU interfaces (banked per core) and the GIC distributor
+#define MPCORE_BASE     0x10100000
+#define NCORE           4           // the MPCore has up to 4 cores
+
+#define PIC_BASE        MPCORE_BASE
+#define PIC_NIRQ        96
+
+// interrupt IDs: 0-15 are software interrupts between cores, the
+// interrupt lines of the board start at 32
+#define IPI_TICK        0           // relays the timer tick, see isr_timer
+#define IPI_RESCHED     1           // asks the cores to reschedule, see gang_start
+#define IPI_TLB         2           // asks the cores to drop TLB entries, see tlb_shootdown
+#define PIC_TIMER01     (32 + 2)
+#define PIC_TIMER23     (32 + 3)
+#define PIC_UART0       (32 + 12)
+
+#endif
@@ -6,8 +6,11 @@
 #include "defs.h"
 #include "memlayout.h"
 #include "spinlock.h"
+#include "proc.h"
 
-// A SP804 has two timers, we only use the first one, and as perodic timer
+// A SP804 has two timers, we only use the first one. It runs as a perodic
+// timer while there is work to do. When the CPU goes idle, the scheduler
+// reprograms it as a one-shot timer for the next deadline (tickless idle).
 
 // define registers (in units of 4-bytes)
 #define TIMER_LOAD	   0	// load register, for perodic timer
@@ -28,6 +31,9 @@ void isr_timer (struct trapframe *tp, int irq_idx);
 struct spinlock tickslock;
 uint ticks;
 
+static uint tick_load;      // timer counts per tick
+static uint idle_ticks;     // length of the one-shot idle period, 0 if periodic
+
 // acknowledge the timer, write any value to TIMER_INTCLR should do
 static void ack_timer ()
 {
@@ -42,20 +48,119 @@ void timer_init(int hz)
 
     initlock(&tickslock, "time");
 
-    timer0[TIMER_LOAD] = CLK_HZ / hz;
+    tick_load = CLK_HZ / hz;
+    timer0[TIMER_LOAD] = tick_load;
     timer0[TIMER_CONTROL] = TIMER_EN|TIMER_PERIODIC|TIMER_32BIT|TIMER_INTEN;
 
     pic_enable (PIC_TIMER01, isr_timer);
 }
 
+// go back to one interrupt per tick. Caller must hold tickslock.
+static void timer_periodic ()
+{
+    volatile uint * timer0 = P2V(TIMER0);
+
+    idle_ticks = 0;
+
+    timer0[TIMER_CONTROL] = 0;
+    ack_timer();
+    timer0[TIMER_LOAD] = tick_load;
+    timer0[TIMER_CONTROL] = TIMER_EN|TIMER_PERIODIC|TIMER_32BIT|TIMER_INTEN;
+}
+
+// stop the periodic tick and interrupt once, nticks ticks from now.
+// nticks <= 0 means there is no deadline, idle as long as the counter
+// allows. Called by the idle scheduler with interrupts disabled.
+void timer_idle (int nticks)
+{
+    volatile uint * timer0 = P2V(TIMER0);
+    uint max;
+
+    max = 0xFFFFFFFF / tick_load;
+
+    if ((nticks <= 0) || (nticks > max)) {
+        nticks = max;
+    }
+
+    acquire(&tickslock);
+
+    idle_ticks = nticks;
+
+    timer0[TIMER_CONTROL] = 0;
+    ack_timer();
+    timer0[TIMER_LOAD] = nticks * tick_load;
+    timer0[TIMER_CONTROL] = TIMER_EN|TIMER_ONESHOT|TIMER_32BIT|TIMER_INTEN;
+
+    release(&tickslock);
+}
+
+// the CPU left idle. If it was woken by another interrupt before the
+// one-shot expired, account for the ticks that passed and resume the
+// periodic tick (a partial tick is dropped).
+void timer_resume (void)
+{
+    volatile uint * timer0 = P2V(TIMER0);
+    uint elapsed;
+
+    acquire(&tickslock);
+
+    if (idle_ticks) {
+        if (timer0[TIMER_CURVAL] == 0) {
+            elapsed = idle_ticks;   // expired, the interrupt is pending
+        } else {
+            elapsed = (idle_ticks * tick_load - timer0[TIMER_CURVAL]) / tick_load;
+        }
+
+        ticks += elapsed;
+        timer_periodic();
+    }
+
+    release(&tickslock);
+}
+
 // interrupt service routine for the timer
 void isr_timer (struct trapframe *tp, int irq_idx)
 {
     acquire(&tickslock);
-    ticks++;
-    wakeup(&ticks);
+
+    if (idle_ticks) {
+        // the one-shot idle period is over, credit all of it
+        ticks += idle_ticks;
+        timer_periodic();
+    } else {
+        ticks++;
+    }
+
     release(&tickslock);
+
+    timer_expire(ticks);
     ack_timer();
+
+#ifdef IPI_TICK
+    // the other cores have no tick of their own, relay it so they can
+    // preempt and look for new work
+    if (ncpu > 1) {
+        pic_sendipi(IPI_TICK);
+    }
+#endif
+}
+
+// microseconds since boot: the ticks so far plus how far the counter
+// is into the current one. Only exact while the tick is periodic, and
+// it may step back a little between the end of a tick and its
+// interrupt, so callers take differences and clamp them.
+uint timer_usec (void)
+{
+    volatile uint * timer0 = P2V(TIMER0);
+    volatile uint * tickp = &ticks;
+    uint t, cur;
+
+    do {
+        t = *tickp;
+        cur = timer0[TIMER_CURVAL];
+    } while (t != *tickp);
+
+    return t * (1000000 / HZ) + (tick_load - cur) / (CLK_HZ / 1000000);
 }
 
 // a short delay, use timer 1 as the source
@@ -26,7 +26,10 @@
 #define TIMER1          0x101E2020
 #define CLK_HZ          1000000     // the clock is 1MHZ
 
+#define NCORE           1           // a single ARM1176 core
+
 #define VIC_BASE        0x10140000
+#define PIC_BASE        VIC_BASE
 #define PIC_TIMER01     4
 #define PIC_TIMER23     5
 #define PIC_UART0       12
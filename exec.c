@@ -103,8 +103,8 @@ int exec (char *path, char **argv)
     ustack[argc] = 0;
 
     // in ARM, parameters are passed in r0 and r1
-    proc->tf->r0 = argc;
-    proc->tf->r1 = sp - (argc + 1) * 4;
+    myproc()->tf->r0 = argc;
+    myproc()->tf->r1 = sp - (argc + 1) * 4;
 
     sp -= (argc + 1) * 4;
 
@@ -119,16 +119,17 @@ int exec (char *path, char **argv)
         }
     }
 
-    safestrcpy(proc->name, last, sizeof(proc->name));
+    safestrcpy(myproc()->name, last, sizeof(myproc()->name));
 
     // Commit to the user image.
-    oldpgdir = proc->pgdir;
-    proc->pgdir = pgdir;
-    proc->sz = sz;
-    proc->tf->pc = elf.entry;
-    proc->tf->sp_usr = sp;
-
-    switchuvm(proc);
+    oldpgdir = myproc()->pgdir;
+    myproc()->pgdir = pgdir;
+    myproc()->main_thread->asid = 0;    // a new address space, a new ASID
+    myproc()->sz = sz;
+    myproc()->tf->pc = elf.entry;
+    myproc()->tf->sp_usr = sp;
+
+    switchuvm(myproc());
     freevm(oldpgdir);
     return 0;
 
@@ -10,15 +10,82 @@
 extern void* end;
 
 struct cpu	cpus[NCPU];
-struct cpu	*cpu;
+int			ncpu;
 
 #define MB (1024*1024)
 
+// point TPIDRPRW at the struct cpu of CPU id, see mycpu
+static void cpu_init (int id)
+{
+    struct cpu *c;
+
+    c = &cpus[id];
+    c->id = id;
+    c->proc = 0;
+
+    asm volatile("MCR p15, 0, %[v], c13, c0, 4": :[v]"r" (c):"memory");
+}
+
+#if NCORE > 1
+extern void _start_mp (void);
+
+static volatile int mp_turn;	// the secondary core allowed to start up
+
+// C entry of the secondary cores, from start_mp once paging is on
+void mpenter (void)
+{
+    uint id;
+
+    asm("MRC p15, 0, %[r], c0, c0, 5": [r]"=r" (id)::);
+    id &= 0x03;
+
+    // start up one at a time, the boot core is waiting for us
+    while (mp_turn != id) {
+    }
+
+    cpu_init (id);
+    trap_stack_init ();		// irq/abort stacks of this core
+    pic_cpuinit ();			// its own GIC CPU interface
+
+    mycpu()->started = 1;
+
+    scheduler ();			// start running processes
+}
+
+// start the other cores of the board
+static void startothers (void)
+{
+    int i, n;
+
+    n = mpcore_init ();
+
+    if (n > NCPU) {
+        n = NCPU;
+    }
+
+    // _start_mp is in the entry section, its address is physical
+    mpcore_boot ((uint)_start_mp);
+
+    for (i = 1; i < n; i++) {
+        runq_init (i);			// its run queue, before anyone uses it
+        mp_turn = i;
+
+        while (!cpus[i].started) {
+        }
+
+        ncpu++;
+    }
+
+    cprintf ("%d cores up\n", ncpu);
+}
+#endif
+
 void kmain (void)
 {
     uint vectbl;
 
-    cpu = &cpus[0];
+    cpu_init (0);
+    ncpu = 1;
 
     uart_init (P2V(UART0));
 
@@ -35,7 +102,8 @@ void kmain (void)
     kmem_init2(P2V(INIT_KERNMAP), P2V(PHYSTOP));
     
     trap_init ();				// vector table and stacks for models
-    pic_init (P2V(VIC_BASE));	// interrupt controller
+    pic_init (P2V(PIC_BASE));	// interrupt controller
+    tlb_init ();				// TLB shootdowns between cores
     uart_enable_rx ();			// interrupt for uart
     consoleinit ();				// console
     pinit ();					// process (locks)
@@ -46,6 +114,9 @@ void kmain (void)
     ideinit ();					// ide (memory block device)
     timer_init (HZ);			// the timer (ticker)
 
+#if NCORE > 1
+    startothers ();				// start the other cores
+#endif
 
     sti ();
 
@@ -34,6 +34,7 @@
 #define KPDE_TYPE   0x02    // use "section" type for kernel page directory
 #define UPDE_TYPE   0x01    // use "coarse page table" for user page directory
 #define PTE_TYPE    0x02    // executable user page(subpage disable)
+#define PTE_NG      (1 << 11)   // not global: TLB entry tagged with the ASID
 
 // 1st-level or large (1MB) page directory (always maps 1MB memory)
 #define PDE_SHIFT   20                      // shift how many bits to get PDE index
@@ -2,9 +2,10 @@
 #define PARAM_INCLUDE
 
 
-#define NPROC        64  // maximum number of processes
+#define NPROC      1024  // maximum number of processes and threads
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
+#define NGROUP       64  // maximum number of ticket groups
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
 #define NBUF         10  // size of disk block cache
@@ -15,6 +16,24 @@
 #define LOGSIZE      10  // max data sectors in on-disk log
 
 #define HZ           10
+#define QUANTUM       1  // scheduling quantum, in timer ticks
+#define COMP_MIN     10  // least fraction of the quantum (per mille) that
+                         //   compensation tickets make up for
+
+// scheduler classes, see setsched() and sched.h
+#define SCHED_LOTTERY 0  // proportional share by random draw
+#define SCHED_STRIDE  1  // deterministic proportional share
+#define SCHED_MLFQ    2  // multi-level feedback queue
+#define SCHED_EDF     3  // real time, earliest deadline first (setrt)
+#define NSCHED        4  // number of scheduler classes
+#define SCHED_POLICY  SCHED_LOTTERY  // policy in effect at boot
+#define STRIDE1  (1 << 20)  // stride of a process holding a single ticket
+#define MLFQ_LEVELS   4  // MLFQ priority levels
+#define MLFQ_ALLOT    2  // MLFQ ticks at the top level, doubling per level
+#define MLFQ_BOOST (5 * HZ)  // ticks between MLFQ boosts to the top level
+#define RT_BWUNIT  1000  // EDF bandwidth unit: a whole CPU
+#define RT_MAXBW    900  // EDF bandwidth a CPU may admit, the rest is kept
+                         //   for the other classes
 
 #define N_CALLSTK    15
 #define PGSIZE 4096 // bytes per page
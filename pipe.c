@@ -16,6 +16,8 @@ struct pipe {
     uint nwrite;    // number of bytes written
     int readopen;   // read fd is still open
     int writeopen;  // write fd is still open
+    int rpid;       // the last process to read, which a blocked writer
+    int wpid;       //   waits for, and the last to write
 };
 
 int pipealloc(struct file **f0, struct file **f1)
@@ -37,6 +39,7 @@ int pipealloc(struct file **f0, struct file **f1)
     p->writeopen = 1;
     p->nwrite = 0;
     p->nread = 0;
+    p->rpid = p->wpid = 0;
 
     initlock(&p->lock, "pipe");
 
@@ -96,6 +99,7 @@ int pipewrite(struct pipe *p, char *addr, int n)
     int i;
 
     acquire(&p->lock);
+    p->wpid = myproc()->pid;
 
     for(i = 0; i < n; i++){
         while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
@@ -105,7 +109,7 @@ int pipewrite(struct pipe *p, char *addr, int n)
             }
 
             wakeup(&p->nread);
-            sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
+            sleeplend(&p->nwrite, &p->lock, p->rpid);  //DOC: pipewrite-sleep
         }
 
         p->data[p->nwrite++ % PIPESIZE] = addr[i];
@@ -121,14 +125,15 @@ int piperead(struct pipe *p, char *addr, int n)
     int i;
 
     acquire(&p->lock);
+    p->rpid = myproc()->pid;
 
     while(p->nread == p->nwrite && p->writeopen){  //DOC: pipe-empty
-        if(proc->killed){
+        if(myproc()->killed){
             release(&p->lock);
             return -1;
         }
 
-        sleep(&p->nread, &p->lock); //DOC: piperead-sleep*/
+        sleeplend(&p->nread, &p->lock, p->wpid); //DOC: piperead-sleep*/
     }
 
     for(i = 0; i < n; i++){  //DOC: piperead-copy
@@ -7,11 +7,16 @@
 #include "proc.h"
 #include "spinlock.h"
 #include "pstat.h"
+#include "sched.h"
 
 #define RAND_MAX 0x7fffffff
 uint rseed = 0;
 
-uint rand()
+#define SLEEPQ_BITS 6
+#define NSLEEPQ     (1 << SLEEPQ_BITS)  // number of sleep queue buckets
+#define NPIDHASH    64                  // number of pid hash buckets
+
+uint rand(void)
 {
     return rseed = (rseed * 1103515245 + 12345) & RAND_MAX;
 }
@@ -33,32 +38,1171 @@ uint rand()
 // between two processes, but instead, between the scheduler. Think of scheduler
 // as the idle process.
 // //
+
+// A ticket currency (after Waldspurger's lottery scheduling). The group
+// holds funding tickets in the base currency, its members hold tickets
+// in the group's currency. Each of those is worth funding / active base
+// tickets, where active counts the tickets of the members that are
+// RUNNABLE or RUNNING: however many members there are, together they
+// compete with the funding of the group. The currency deflates as more
+// members become active and inflates as they block.
+//
+// A group may also have a hard cap, a quota of ticks of CPU time per
+// period (see setquota). The tick charges the members that run against
+// it, and once it is spent the group is throttled: its members are
+// held off the run queues until the next period starts.
+struct group
+{
+    int id;             // 1 + index in ptable.groups, 0 if free
+    int anon;           // thread group, funded by its main thread
+    int funding;        // tickets in the base currency
+    int active;         // tickets issued to active members
+    struct proc *members;
+    int quota;          // ticks of CPU time per period, 0 for no cap
+    int period;         // in ticks
+    int used;           // ticks used in the current period
+    uint pstart;        // tick the current period started at
+    int throttled;      // quota spent, members held off the run queues
+    uint throttledticks;// ticks spent throttled in all
+};
+
 struct
 {
-    struct spinlock lock;
-    struct proc proc[NPROC];
-} ptable;
+    struct spinlock lock;
+
+    // proc objects are allocated on demand: whole pages from the buddy
+    // allocator are carved into procs, and slot i points to the i-th
+    // proc carved so far. A proc keeps its slot for good; when freed it
+    // goes back on the UNUSED list, which serves as the object cache.
+    struct proc *proc[NPROC];
+    int nslot;      // number of procs carved so far
+
+    // one run queue per CPU. A process is queued on the run queue of
+    // p->cpu; idle or lightly loaded CPUs pull work over (see balance).
+    // A RUNNABLE or RUNNING process belongs to its run queue: it is
+    // picked, switched to and back, and moved to another CPU under the
+    // lock of that alone. ptable.lock guards the rest of its life (see
+    // setstate). Lock order: ptable.lock, then the lock of a run queue;
+    // two run queue locks are taken lower index first (see runq_lock2).
+    struct runq rq[NCPU];
+
+    int policy;     // the system-wide scheduler class, SCHED_*
+
+    struct group groups[NGROUP];
+
+    uint ganground; // the last gang round started, see gang_start
+    int nthrottled; // groups throttled, waiting for their next period
+
+    // sleep queues: SLEEPING processes hashed by the channel they sleep
+    // on, oldest first, so wakeup only visits processes that may match.
+    struct
+    {
+        struct proc *head;
+        struct proc *tail;
+    } sleepq[NSLEEPQ];
+
+    // timer heap: processes in sleepfor() ordered by deadline, so a tick
+    // only looks at the earliest one.
+    struct pheap timers;
+
+    // every proc is on exactly one of these lists, by state, so nothing
+    // has to scan the table to find a free, runnable or live process.
+    struct proc *list[ZOMBIE + 1];
+
+    // pid -> proc for every live process. pids are handed out in
+    // sequence, so pid % NPIDHASH spreads them evenly.
+    struct proc *pidhash[NPIDHASH];
+} ptable;
+
+
+
+static struct proc *initproc;
+
+//static int total_tickets =0; //keep track of tickets in lottery scheduler
+
+int nextpid = 1;
+extern void forkret(void);
+extern void trapret(void);
+
+// scheduler classes by SCHED_* number
+static struct sched_class *classes[NSCHED] = {
+    [SCHED_LOTTERY] = &lottery_class,
+    [SCHED_STRIDE] = &stride_class,
+    [SCHED_MLFQ] = &mlfq_class,
+    [SCHED_EDF] = &edf_class,
+};
+
+// the order in which the classes get to pick: real time first
+static int precedence[NSCHED] = {
+    SCHED_EDF, SCHED_LOTTERY, SCHED_STRIDE, SCHED_MLFQ
+};
+
+static void wakeup1(void *chan);
+static int deadline_before(struct proc *a, struct proc *b);
+static void sched_unlock(void);
+
+void pinit(void)
+{
+    initlock(&ptable.lock, "ptable");
+
+    runq_init(0);
+
+    ptable.timers.slot = sched_page();
+    ptable.timers.key = TIMER_HEAP;
+    ptable.timers.before = deadline_before;
+
+    ptable.policy = SCHED_POLICY;
+}
+
+// A zeroed page for an index of up to NPROC processes: the heaps and
+// the lottery tree of a run queue, and the timer heap.
+void *sched_page(void)
+{
+    void *page;
+
+    if (NPROC * sizeof(struct proc *) > PTE_SZ || (page = alloc_page()) == 0)
+    {
+        panic("sched_page");
+    }
+
+    memset(page, 0, PTE_SZ);
+    return page;
+}
+
+// Set up the run queue of CPU c before the CPU comes up: only the CPUs
+// the board has pay for the indexes of the classes.
+void runq_init(int c)
+{
+    int i;
+
+    initlock(&ptable.rq[c].lock, "runq");
+
+    for (i = 0; i < NSCHED; i++)
+    {
+        classes[i]->init(&ptable.rq[c]);
+    }
+}
+
+// tickets p competes with right now, in the base currency. A process
+// that has sleep boosts left competes with twice its tickets, and one
+// that holds compensation tickets (see charge) with its tickets over
+// the fraction of the quantum it used; plus any tickets it borrowed.
+int effective_tickets(struct proc *p)
+{
+    struct group *g;
+    int eff;
+
+    eff = p->tickets;
+
+    if ((g = p->group) != 0 && g->active > 0)
+    {
+        eff = eff * g->funding / g->active;
+
+        if (eff < 1)
+        {
+            eff = 1;
+        }
+    }
+
+    if (p->boostsleft > 0)
+    {
+        eff *= 2;
+    }
+
+    if (p->compfrac > 0)
+    {
+        eff = eff * 1000 / p->compfrac;
+    }
+
+    return eff + p->borrowed;
+}
+
+static void heap_swap(struct pheap *h, int i, int j)
+{
+    struct proc *t;
+
+    t = h->slot[i];
+    h->slot[i] = h->slot[j];
+    h->slot[j] = t;
+
+    h->slot[i]->heapidx[h->key] = i;
+    h->slot[j]->heapidx[h->key] = j;
+}
+
+static void heap_siftup(struct pheap *h, int i)
+{
+    while (i > 0 && h->before(h->slot[i], h->slot[(i - 1) / 2]))
+    {
+        heap_swap(h, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void heap_siftdown(struct pheap *h, int i)
+{
+    int min, c;
+
+    for (;;)
+    {
+        min = i;
+
+        for (c = 2 * i + 1; c <= 2 * i + 2 && c < h->n; c++)
+        {
+            if (h->before(h->slot[c], h->slot[min]))
+            {
+                min = c;
+            }
+        }
+
+        if (min == i)
+        {
+            break;
+        }
+
+        heap_swap(h, i, min);
+        i = min;
+    }
+}
+
+void heap_insert(struct pheap *h, struct proc *p)
+{
+    int i;
+
+    i = h->n++;
+    h->slot[i] = p;
+    p->heapidx[h->key] = i;
+    heap_siftup(h, i);
+}
+
+void heap_remove(struct pheap *h, struct proc *p)
+{
+    struct proc *last;
+    int i;
+
+    i = p->heapidx[h->key];
+    p->heapidx[h->key] = -1;
+    last = h->slot[--h->n];
+
+    if (last != p)
+    {
+        h->slot[i] = last;
+        last->heapidx[h->key] = i;
+        heap_siftup(h, i);
+        heap_siftdown(h, last->heapidx[h->key]);
+    }
+}
+
+// Interrupt CPU c: it leaves wfi if it waits for work (see idle), or
+// enters the kernel if it runs a user process (see resched).
+static void kick(int c)
+{
+#ifdef IPI_RESCHED
+    pic_sendipi_to(IPI_RESCHED, c);
+#endif
+}
+
+// Lock the run queue of p. p may move to another one while we wait
+// for the lock (see runq_move), so look again once we hold it.
+static struct runq *runq_lock(struct proc *p)
+{
+    struct runq *rq;
+
+    for (;;)
+    {
+        rq = &ptable.rq[p->cpu];
+        acquire(&rq->lock);
+
+        if (rq == &ptable.rq[p->cpu])
+        {
+            return rq;
+        }
+
+        release(&rq->lock);
+    }
+}
+
+// Lock run queues a and b, which may be the same one, lower index
+// first so that two CPUs doing so never wait for each other.
+static void runq_lock2(struct runq *a, struct runq *b)
+{
+    if (a > b)
+    {
+        runq_lock2(b, a);
+        return;
+    }
+
+    acquire(&a->lock);
+
+    if (b != a)
+    {
+        acquire(&b->lock);
+    }
+}
+
+static void runq_unlock2(struct runq *a, struct runq *b)
+{
+    if (b != a)
+    {
+        release(&b->lock);
+    }
+
+    release(&a->lock);
+}
+
+// Queue RUNNABLE process p on the run queue of p->cpu, by its class.
+// A member of a throttled group is parked instead: it stays RUNNABLE
+// but waits off the queue until the group's next period. Caller must
+// hold the lock of the run queue.
+static void sched_enqueue(struct proc *p)
+{
+    struct runq *rq;
+
+    if (p->group && p->group->throttled)
+    {
+        p->parked = 1;
+        return;
+    }
+
+    rq = &ptable.rq[p->cpu];
+
+    rq->nrun++;
+    rq->load += p->tickets;
+    classes[p->sched]->enqueue(rq, p);
+
+    // another CPU with nothing to run would only notice at its next tick
+    if (rq->curr == 0 && p->cpu != mycpu()->id)
+    {
+        kick(p->cpu);
+    }
+}
+
+// Caller must hold the lock of p's run queue.
+static void sched_dequeue(struct proc *p)
+{
+    struct runq *rq;
+
+    if (p->parked)
+    {
+        p->parked = 0;
+        return;
+    }
+
+    rq = &ptable.rq[p->cpu];
+
+    rq->nrun--;
+    rq->load -= p->tickets;
+    classes[p->sched]->dequeue(rq, p);
+}
+
+// The process to run next on rq: the pick of the first class in order
+// of precedence that has one, or 0 if none has. Caller must hold the
+// lock of rq.
+static struct proc *sched_pick(struct runq *rq)
+{
+    struct proc *p;
+    int c;
+
+    p = 0;
+
+    for (c = 0; c < NSCHED && rq->nrun > 0; c++)
+    {
+        if ((p = classes[precedence[c]]->pick_next(rq)) != 0)
+        {
+            break;
+        }
+    }
+
+    return p;
+}
+
+static int active(enum procstate state)
+{
+    return state == RUNNABLE || state == RUNNING;
+}
+
+// effective_tickets(p) changed: bring p's run queue up to date
+static void sched_reweigh(struct proc *p)
+{
+    struct runq *rq;
+
+    rq = runq_lock(p);
+
+    if (p->state == RUNNABLE && !p->parked && classes[p->sched]->reweigh)
+    {
+        classes[p->sched]->reweigh(rq, p);
+    }
+
+    release(&rq->lock);
+}
+
+// The value of the tickets of group g changed: bring the queued members
+// other than skip up to date.
+static void group_reweigh(struct group *g, struct proc *skip)
+{
+    struct proc *m;
+
+    for (m = g->members; m != 0; m = m->gnext)
+    {
+        if (m != skip)
+        {
+            sched_reweigh(m);
+        }
+    }
+}
+
+// Allocate a group, or return 0 if there is none free.
+static struct group *group_alloc(int anon, int funding)
+{
+    struct group *g;
+
+    for (g = ptable.groups; g < &ptable.groups[NGROUP]; g++)
+    {
+        if (g->id == 0)
+        {
+            g->id = g - ptable.groups + 1;
+            g->anon = anon;
+            g->funding = funding;
+            g->active = 0;
+            g->members = 0;
+            g->quota = 0;
+            g->throttled = 0;
+            g->throttledticks = 0;
+            return g;
+        }
+    }
+
+    return 0;
+}
+
+static struct group *group_find(int id)
+{
+    if (id < 1 || id > NGROUP || ptable.groups[id - 1].id == 0)
+    {
+        return 0;
+    }
+
+    return &ptable.groups[id - 1];
+}
+
+// Add p, not queued, to group g. If p is RUNNABLE or RUNNING, the
+// caller reweighs the other members (see group_move).
+static void group_join(struct proc *p, struct group *g)
+{
+    p->group = g;
+    p->gprev = 0;
+    p->gnext = g->members;
+
+    if (g->members)
+    {
+        g->members->gprev = p;
+    }
+
+    g->members = p;
+
+    if (active(p->state))
+    {
+        g->active += p->tickets;
+    }
+}
+
+// Take p, not queued, out of its group. The last one out frees it.
+// As for group_join, the caller reweighs the members left.
+static void group_leave(struct proc *p)
+{
+    struct group *g;
+
+    g = p->group;
+
+    if (p->gprev)
+    {
+        p->gprev->gnext = p->gnext;
+    }
+    else
+    {
+        g->members = p->gnext;
+    }
+
+    if (p->gnext)
+    {
+        p->gnext->gprev = p->gprev;
+    }
+
+    p->group = 0;
+    p->gnext = p->gprev = 0;
+
+    if (g->members == 0)
+    {
+        if (g->throttled)
+        {
+            ptable.nthrottled--;
+        }
+
+        g->id = 0;
+    }
+    else if (active(p->state))
+    {
+        g->active -= p->tickets;
+    }
+}
+
+// Move p over to group g (0 for none). p's run queue is locked while
+// p changes groups, as whether it is queued or parked depends on them;
+// the other members are reweighed after, under their own locks.
+static void group_move(struct proc *p, struct group *g)
+{
+    struct group *old;
+    struct runq *rq;
+
+    if ((old = p->group) == g)
+    {
+        return;
+    }
+
+    rq = runq_lock(p);
+
+    if (p->state == RUNNABLE)
+    {
+        sched_dequeue(p);
+    }
+
+    if (old)
+    {
+        group_leave(p);
+    }
+
+    if (g)
+    {
+        group_join(p, g);
+    }
+
+    if (p->state == RUNNABLE)
+    {
+        sched_enqueue(p);
+    }
+
+    release(&rq->lock);
+
+    // p may go from RUNNABLE to RUNNING or back without ptable.lock,
+    // but not start or stop being one of them
+    if (active(p->state))
+    {
+        if (old)
+        {
+            group_reweigh(old, 0);
+        }
+
+        if (g)
+        {
+            group_reweigh(g, p);
+        }
+    }
+}
+
+// Load of a run queue for balancing: the tickets of the processes it
+// holds, including the one running.
+static int runq_load(struct runq *rq)
+{
+    return rq->load + (rq->curr ? rq->curr->tickets : 0);
+}
+
+// The CPU to queue p on as it becomes RUNNABLE. p prefers last, the
+// CPU it ran on last (or that its creator runs on), where its caches
+// and TLB entries may still be warm; a new thread shares them with its
+// creator outright. The bias is bounded: p stays only while last is
+// not busier than the least loaded CPU by more than p's own tickets,
+// so moving p would not make the loads any more level. The loads are
+// read without their locks: a stale one only makes p land less evenly.
+static int runq_place(struct proc *p, int last)
+{
+    int i, best;
+
+    if (classes[p->sched]->pinned)
+    {
+        return p->cpu;
+    }
+
+    best = last;
+
+    for (i = 0; i < ncpu; i++)
+    {
+        if (runq_load(&ptable.rq[i]) < runq_load(&ptable.rq[best]))
+        {
+            best = i;
+        }
+    }
+
+    if (runq_load(&ptable.rq[last]) - runq_load(&ptable.rq[best]) <= p->tickets)
+    {
+        return last;
+    }
+
+    return best;
+}
+
+// Move p over to the run queue of CPU c if it is queued, which it may
+// no longer be by the time we hold the locks. Returns whether it was.
+static int runq_move(struct proc *p, int c)
+{
+    struct runq *from, *to;
+    int queued;
+
+    to = &ptable.rq[c];
+
+    for (;;)
+    {
+        from = &ptable.rq[p->cpu];
+        runq_lock2(from, to);
+
+        if (from == &ptable.rq[p->cpu])
+        {
+            break;
+        }
+
+        runq_unlock2(from, to);
+    }
+
+    queued = (p->state == RUNNABLE && !p->parked);
+
+    if (queued && from != to)
+    {
+        sched_dequeue(p);
+        p->cpu = c;
+        sched_enqueue(p);
+    }
+
+    runq_unlock2(from, to);
+
+    return queued;
+}
+
+static int deadline_before(struct proc *a, struct proc *b)
+{
+    return a->sleeptarget - b->sleeptarget < 0;
+}
+
+// sleep queue bucket of a channel (Fibonacci hashing, channels are
+// both kernel addresses and small integers from getChannel)
+static int sleepq_hash(void *chan)
+{
+    return ((uint)chan * 2654435761U) >> (32 - SLEEPQ_BITS);
+}
+
+static void sleepq_insert(struct proc *p)
+{
+    int h;
+
+    h = sleepq_hash(p->chan);
+
+    p->qnext = 0;
+    p->qprev = ptable.sleepq[h].tail;
+
+    if (p->qprev)
+    {
+        p->qprev->qnext = p;
+    }
+    else
+    {
+        ptable.sleepq[h].head = p;
+    }
+
+    ptable.sleepq[h].tail = p;
+}
+
+static void sleepq_remove(struct proc *p)
+{
+    int h;
+
+    h = sleepq_hash(p->chan);
+
+    if (p->qprev)
+    {
+        p->qprev->qnext = p->qnext;
+    }
+    else
+    {
+        ptable.sleepq[h].head = p->qnext;
+    }
+
+    if (p->qnext)
+    {
+        p->qnext->qprev = p->qprev;
+    }
+    else
+    {
+        ptable.sleepq[h].tail = p->qprev;
+    }
+
+    p->qnext = p->qprev = 0;
+}
+
+// The list the processes in state are on. RUNNABLE and RUNNING ones
+// share one, so that the scheduler switches between the two without
+// ptable.lock, which guards the lists.
+static int statelist(enum procstate state)
+{
+    return state == RUNNING ? RUNNABLE : state;
+}
+
+// Move p from the list of its current state to the list of state.
+static void statelist_move(struct proc *p, enum procstate state)
+{
+    if (statelist(p->state) == statelist(state))
+    {
+        return;
+    }
+
+    if (p->sprev)
+    {
+        p->sprev->snext = p->snext;
+    }
+    else
+    {
+        ptable.list[statelist(p->state)] = p->snext;
+    }
+
+    if (p->snext)
+    {
+        p->snext->sprev = p->sprev;
+    }
+
+    p->sprev = 0;
+    p->snext = ptable.list[statelist(state)];
+
+    if (p->snext)
+    {
+        p->snext->sprev = p;
+    }
+
+    ptable.list[statelist(state)] = p;
+}
+
+// Iterate over the live (not UNUSED) processes: return the one after p,
+// or the first one if p is 0. p must not change lists in between.
+static struct proc *nextlive(struct proc *p)
+{
+    int s;
+
+    if (p && p->snext)
+    {
+        return p->snext;
+    }
+
+    for (s = p ? statelist(p->state) + 1 : EMBRYO; s <= ZOMBIE; s++)
+    {
+        if (ptable.list[s])
+        {
+            return ptable.list[s];
+        }
+    }
+
+    return 0;
+}
+
+static void pidhash_insert(struct proc *p)
+{
+    struct proc **pp;
+
+    pp = &ptable.pidhash[p->pid % NPIDHASH];
+    p->pidnext = *pp;
+    *pp = p;
+}
+
+static void pidhash_remove(struct proc *p)
+{
+    struct proc **pp;
+
+    for (pp = &ptable.pidhash[p->pid % NPIDHASH]; *pp != 0; pp = &(*pp)->pidnext)
+    {
+        if (*pp == p)
+        {
+            *pp = p->pidnext;
+            break;
+        }
+    }
+
+    p->pidnext = 0;
+}
+
+// Look up a live process by pid. Caller must hold ptable.lock.
+static struct proc *findproc(int pid)
+{
+    struct proc *p;
+
+    if (pid <= 0)
+    {
+        return 0;
+    }
+
+    for (p = ptable.pidhash[pid % NPIDHASH]; p != 0; p = p->pidnext)
+    {
+        if (p->pid == pid)
+        {
+            return p;
+        }
+    }
+
+    return 0;
+}
+
+// The list of p's kin that p belongs to: a thread is on its main
+// thread's thread list, a process on its parent's list of running
+// children, or of zombie children once it has exited.
+static struct proc **kin_head(struct proc *p)
+{
+    if (p->is_thread)
+    {
+        return &p->main_thread->threads;
+    }
+
+    return p->state == ZOMBIE ? &p->parent->zombies : &p->parent->children;
+}
+
+static void kin_insert(struct proc *p)
+{
+    struct proc **head;
+
+    head = kin_head(p);
+
+    p->sibprev = 0;
+    p->sibnext = *head;
+
+    if (p->sibnext)
+    {
+        p->sibnext->sibprev = p;
+    }
+
+    *head = p;
+}
+
+static void kin_remove(struct proc *p)
+{
+    if (p->sibprev)
+    {
+        p->sibprev->sibnext = p->sibnext;
+    }
+    else
+    {
+        *kin_head(p) = p->sibnext;
+    }
+
+    if (p->sibnext)
+    {
+        p->sibnext->sibprev = p->sibprev;
+    }
+
+    p->sibnext = p->sibprev = 0;
+}
+
+// The process p lends its tickets to, 0 if none or it is gone.
+static struct proc *lendee(struct proc *p)
+{
+    struct proc *to;
+
+    to = p->lendto;
+
+    if (to == 0 || to->pid != p->lendpid || to->state == UNUSED)
+    {
+        return 0;
+    }
+
+    return to;
+}
+
+// n more tickets (or fewer, if negative) are lent to process to. A
+// process that is itself asleep lending passes them on, down the chain
+// to the process that can actually make progress. The chains have no
+// cycles (see lend), so this ends.
+static void lend_add(struct proc *to, int n)
+{
+    while (to != 0)
+    {
+        to->borrowed += n;
+        sched_reweigh(to);
+
+        if (lendee(to) == 0)
+        {
+            break;
+        }
+
+        to->lent += n;
+        to = lendee(to);
+    }
+}
+
+// p is about to sleep waiting for process pid: lend p's effective
+// tickets, including those it borrowed, to it so that they are not
+// wasted while it crawls along on its own. Each process records only
+// the one it waits for; the tickets flow on from there (see lend_add),
+// so when one in the middle of a chain wakes, what passed through it
+// stays with it.
+static void lend(struct proc *p, int pid)
+{
+    struct proc *to, *q;
+
+    if (pid == 0 || (to = findproc(pid)) == 0 || to->state == ZOMBIE)
+    {
+        return;
+    }
+
+    // no cycles: to must not (indirectly) wait for p
+    for (q = to; q != 0; q = lendee(q))
+    {
+        if (q == p)
+        {
+            return;
+        }
+    }
+
+    p->lent = effective_tickets(p);
+    p->lendto = to;
+    p->lendpid = to->pid;
+    lend_add(to, p->lent);
+}
+
+// p woke up: take back the tickets it passed on. Those lent to p by
+// the processes waiting for it stay with it.
+static void unlend(struct proc *p)
+{
+    lend_add(lendee(p), -p->lent);
+
+    p->lendto = 0;
+    p->lent = 0;
+}
+
+// p leaves the CPU for state: account for the time it ran, to p and
+// to its class (e.g., the real-time budget). A process that blocked
+// before its quantum was over gets compensation tickets, which inflate
+// its tickets by quantum / used until it next runs, so that an
+// I/O-bound process still gets its share of the CPU over time.
+// Preempted processes get none: a quantum may start mid-tick and end
+// at the next one. Caller must hold the lock of p's run queue.
+static void account(struct proc *p, enum procstate state)
+{
+    int used, quantum;
+
+    quantum = QUANTUM * (1000000 / HZ);
+    used = timer_usec() - p->sliceus;
+
+    if (used < 0)
+    {
+        used = 0;
+    }
+
+    p->runus += used;
+
+    if (classes[p->sched]->account)
+    {
+        classes[p->sched]->account(&ptable.rq[p->cpu], p, used);
+    }
+
+    if (state == SLEEPING && used < quantum)
+    {
+        p->compfrac = used * 1000 / quantum;
+
+        if (p->compfrac < COMP_MIN)
+        {
+            p->compfrac = COMP_MIN;
+        }
+    }
+}
+
+// p joins class c, on the run queue of p->cpu, whose lock the caller
+// must hold
+static void class_enter(struct proc *p, int c)
+{
+    if (classes[c]->enter)
+    {
+        classes[c]->enter(&ptable.rq[p->cpu], p);
+    }
+}
+
+// p leaves its class, on the run queue of p->cpu, whose lock the
+// caller must hold
+static void class_exit(struct proc *p)
+{
+    if (classes[p->sched]->exit)
+    {
+        classes[p->sched]->exit(&ptable.rq[p->cpu], p);
+    }
+}
+
+// Change the state of p. All state transitions go through here, or
+// through setrunstate, so that the scheduler's indexes stay consistent.
+// Caller must hold ptable.lock, and no run queue lock: p's is taken
+// here around the changes to its run queue.
+static void setstate(struct proc *p, enum procstate state)
+{
+    struct runq *rq;
+
+    // before p is queued again, on the state it leaves the CPU for
+    if (p->state == RUNNING)
+    {
+        rq = runq_lock(p);
+        account(p, state);
+
+        if (state == ZOMBIE)
+        {
+            class_exit(p);
+        }
+
+        release(&rq->lock);
+    }
+
+    if (state == UNUSED && p->state != UNUSED)
+    {
+        pidhash_remove(p);
+    }
+
+    statelist_move(p, state);
+
+    if (p->state == SLEEPING)
+    {
+        sleepq_remove(p);
+
+        if (p->lendto)
+        {
+            unlend(p);
+        }
+
+        // woken before its deadline (e.g., killed)
+        if (p->heapidx[TIMER_HEAP] >= 0)
+        {
+            heap_remove(&ptable.timers, p);
+        }
+    }
+
+    // a new process starts out near its creator, a woken one near where
+    // it ran last. Either may still be switching out on another CPU (a
+    // sleeper is woken as soon as we get ptable.lock); the scheduler
+    // that picks it waits for that, see pick.
+    if (p->state == EMBRYO && state == RUNNABLE)
+    {
+        p->cpu = runq_place(p, myproc() ? mycpu()->id : 0);
+    }
+    else if (p->state == SLEEPING && state == RUNNABLE)
+    {
+        p->cpu = runq_place(p, p->cpu);
+    }
+
+    // p joins or leaves the active members of its group
+    if (p->group && active(p->state) != active(state))
+    {
+        p->group->active += active(state) ? p->tickets : -p->tickets;
+        group_reweigh(p->group, p);
+    }
+
+    // once queued, p is the run queue's: it may run right away
+    if (state == RUNNABLE)
+    {
+        rq = &ptable.rq[p->cpu];
+
+        acquire(&rq->lock);
+
+        if (p->state == EMBRYO)
+        {
+            class_enter(p, p->sched);
+        }
+
+        p->state = state;
+        sched_enqueue(p);
+        release(&rq->lock);
+
+        return;
+    }
+
+    p->state = state;
+
+    if (state == SLEEPING)
+    {
+        sleepq_insert(p);
+    }
+
+    if ((state == ZOMBIE || state == UNUSED) && p->group)
+    {
+        group_leave(p);
+    }
+}
+
+// Move p between RUNNABLE and RUNNING: the scheduler picks it, or it
+// gives up the CPU and waits for its next turn. That touches nothing
+// but p's run queue, so its lock is all the caller must hold.
+static void setrunstate(struct proc *p, enum procstate state)
+{
+    if (state == RUNNING)
+    {
+        sched_dequeue(p);
+    }
+    else
+    {
+        account(p, state);
+    }
+
+    p->state = state;
+
+    if (state == RUNNABLE)
+    {
+        sched_enqueue(p);
+    }
+}
+
+// Wait until p's kernel stack and context are free of the CPU that ran
+// it last, which clears p->oncpu once it switched away (see scheduler).
+static void oncpu_wait(struct proc *p)
+{
+    while (p->oncpu)
+    {
+    }
 
+    // and see what that CPU stored there before it let go
+    asm volatile("MCR p15, 0, %[r], c7, c10, 5" : : [r] "r"(0) : "memory");
+}
 
+// Carve a fresh page from the buddy allocator into procs and put them
+// on the UNUSED list. Returns -1 if the table is full or memory is out.
+// Caller must hold ptable.lock.
+static int procache_grow(void)
+{
+    struct proc *p;
+    char *page;
+    int i, n;
 
-static struct proc *initproc;
-struct proc *proc;
+    n = PTE_SZ / sizeof(struct proc);
 
-//static int total_tickets =0; //keep track of tickets in lottery scheduler
+    if (n > NPROC - ptable.nslot)
+    {
+        n = NPROC - ptable.nslot;
+    }
 
-int nextpid = 1;
-extern void forkret(void);
-extern void trapret(void);
+    if (n <= 0 || (page = alloc_page()) == 0)
+    {
+        return -1;
+    }
 
-static void wakeup1(void *chan);
+    memset(page, 0, PTE_SZ);
 
-void pinit(void)
-{
-    initlock(&ptable.lock, "ptable");
+    for (i = 0; i < n; i++)
+    {
+        p = (struct proc *)page + i;
+        p->slot = ptable.nslot++;
+        memset(p->heapidx, -1, sizeof(p->heapidx));
+        ptable.proc[p->slot] = p;
+
+        p->snext = ptable.list[UNUSED];
+
+        if (p->snext)
+        {
+            p->snext->sprev = p;
+        }
+
+        ptable.list[UNUSED] = p;
+    }
+
+    return 0;
 }
 
 // PAGEBREAK: 32
-//  Look in the process table for an UNUSED proc.
+//  Look in the process table for an UNUSED proc, growing the table
+//  if there is none.
 //  If found, change state to EMBRYO and initialize
 //  state required to run in the kernel.
 //  Otherwise return 0.
@@ -69,20 +1213,35 @@ static struct proc *allocproc(void)
 
     acquire(&ptable.lock);
 
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if (ptable.list[UNUSED] == 0 && procache_grow() < 0)
     {
-        if (p->state == UNUSED)
-        {
-            goto found;
-        }
+        release(&ptable.lock);
+        return 0;
     }
 
-    release(&ptable.lock);
-    return 0;
+    p = ptable.list[UNUSED];
 
-    found:
-    p->state = EMBRYO;
+    setstate(p, EMBRYO);
     p->pid = nextpid++;
+    pidhash_insert(p);
+
+    p->is_thread = 0;
+    p->main_thread = p;
+    p->asid = 0;
+
+    // a class chosen for the creator alone (e.g., a real-time
+    // reservation) is not passed on
+    p->sched = ptable.policy;
+    p->rtmisses = 0;
+    p->borrowed = 0;
+    p->lendto = 0;
+    p->runus = 0;
+    p->compfrac = 0;
+    p->gang = 0;
+    p->ganground = 0;
+    p->parked = 0;
+
+    p->children = p->zombies = p->threads = 0;
     // p->tickets = 1;  //giving the value
     // p->boostsleft = 0;
     // p->sleepticks = 0;
@@ -92,7 +1251,9 @@ static struct proc *allocproc(void)
     // Allocate kernel stack.
     if ((p->kstack = alloc_page()) == 0)
     {
-        p->state = UNUSED;
+        acquire(&ptable.lock);
+        setstate(p, UNUSED);
+        release(&ptable.lock);
         return 0;
     }
 
@@ -122,8 +1283,8 @@ static struct proc *allocproc(void)
     // it use our implementation.
     p->context->lr = (uint)forkret + 4;
 
-    if(proc->parent){
-        p->tickets = proc->parent->tickets;
+    if(myproc()->parent){
+        p->tickets = myproc()->parent->tickets;
     }
     
     else{
@@ -132,6 +1293,10 @@ static struct proc *allocproc(void)
     }
     
     p->boostsleft = 0;    // no initial boost
+    p->runticks = 0;
+    p->forfeit = 0;
+    p->mlfqlevel = 0;
+    p->mlfqstart = 0;
     // p->tickets = 0;
     // p->runticks = 0;
     // p->boostsleft = 0;
@@ -182,7 +1347,9 @@ void userinit(void)
     safestrcpy(p->name, "initcode", sizeof(p->name));
     p->cwd = namei("/");
 
-    p->state = RUNNABLE;
+    acquire(&ptable.lock);
+    setstate(p, RUNNABLE);
+    release(&ptable.lock);
 
     // p->tickets = 1;
     // p->runticks = 0;
@@ -195,25 +1362,24 @@ int growproc(int n)
 {
     uint sz;
 
-    sz = proc->sz;
+    sz = myproc()->sz;
 
     if (n > 0)
     {
-        if ((sz = allocuvm(proc->pgdir, sz, sz + n)) == 0)
+        if ((sz = allocuvm(myproc()->pgdir, sz, sz + n)) == 0)
         {
             return -1;
         }
     }
     else if (n < 0)
     {
-        if ((sz = deallocuvm(proc->pgdir, sz, sz + n)) == 0)
+        if ((sz = shrinkuvm(myproc(), sz, sz + n)) == 0)
         {
             return -1;
         }
     }
 
-    proc->sz = sz;
-    switchuvm(proc);
+    myproc()->sz = sz;
 
     return 0;
 }
@@ -233,256 +1399,728 @@ int fork(void)
     }
 
     // Copy process state from p.
-    if ((np->pgdir = copyuvm(proc->pgdir, proc->sz)) == 0)
+    if ((np->pgdir = copyuvm(myproc()->pgdir, myproc()->sz)) == 0)
     {
         free_page(np->kstack);
         np->kstack = 0;
 	// np->tickets = proc->tickets;   // child inherits parent's tickets
         // np->tickets = proc->tickets;
-	    np->state = UNUSED;
+        acquire(&ptable.lock);
+        setstate(np, UNUSED);
+        release(&ptable.lock);
         return -1;
     }
 
-    np->sz = proc->sz;
-    np->parent = proc;
-    *np->tf = *proc->tf;
+    np->sz = myproc()->sz;
+    *np->tf = *myproc()->tf;
+
+    // Clear r0 so that fork returns 0 in the child.
+    np->tf->r0 = 0;
+
+    for (i = 0; i < NOFILE; i++)
+    {
+        if (myproc()->ofile[i])
+        {
+            np->ofile[i] = filedup(myproc()->ofile[i]);
+        }
+    }
+
+    np->cwd = idup(myproc()->cwd);
+
+    pid = np->pid;
+    safestrcpy(np->name, myproc()->name, sizeof(myproc()->name));
+
+    acquire(&ptable.lock);
+    np->parent = myproc();
+    kin_insert(np);
+
+    // a child stays in its parent's group, but not in its thread group
+    if (myproc()->group && !myproc()->group->anon)
+    {
+        group_join(np, myproc()->group);
+    }
+
+    setstate(np, RUNNABLE);
+    release(&ptable.lock);
+
+    // np->tickets = proc->tickets > 0 ? proc->tickets : 1;
+    // np->runticks = 0;
+    // np->boostsleft = 0;
+
+    return pid;
+}
+
+// Free a ZOMBIE thread. Caller must hold ptable.lock.
+static void thread_reap(struct proc *p)
+{
+    kin_remove(p);
+    oncpu_wait(p);
+    free_page(p->kstack);
+    p->kstack = 0;
+    setstate(p, UNUSED);
+    p->pid = 0;
+    p->parent = 0;
+    p->main_thread = 0;
+    p->name[0] = 0;
+    p->killed = 0;
+}
+
+// Exit the current process.  Does not return.
+// An exited process remains in the zombie state
+// until its parent calls wait() to find out it exited.
+void exit(void)
+{
+    struct proc *p, *next;
+    int fd, alive;
+    
+    if (myproc() == initproc)
+    {
+        panic("init exiting");
+    }
+
+    // a thread (e.g., killed) ends alone, its process lives on
+    if (myproc()->is_thread)
+    {
+        thread_exit();
+    }
+
+    // Close all open files.
+    for (fd = 0; fd < NOFILE; fd++)
+    {
+        if (myproc()->ofile[fd])
+        {
+            fileclose(myproc()->ofile[fd]);
+            myproc()->ofile[fd] = 0;
+        }
+    }
+
+    iput(myproc()->cwd);
+    myproc()->cwd = 0;
+
+    acquire(&ptable.lock);
+
+    // The threads run on our page table, which goes with us, and point
+    // at us through main_thread: kill them and free them before we
+    // become a zombie that wait() recycles.
+    for (;;)
+    {
+        alive = 0;
+
+        for (p = myproc()->threads; p != 0; p = next)
+        {
+            next = p->sibnext;
+
+            if (p->state == ZOMBIE)
+            {
+                thread_reap(p);
+                continue;
+            }
+
+            alive = 1;
+            p->killed = 1;
+
+            if (p->state == SLEEPING)
+            {
+                setstate(p, RUNNABLE);
+            }
+        }
+
+        if (!alive)
+        {
+            break;
+        }
+
+        // thread_exit() wakes us up
+        sleep(myproc(), &ptable.lock);
+    }
+
+    // struct proc *t;
+    // // for(t = ptable.proc; t < &ptable.proc[NPROC]; t++) {
+    // //     if(t->main_thread == proc && t->is_spawned_thread && t->state != ZOMBIE) {
+    // //         sleep(proc, &ptable.lock);
+    // //     }
+    // // }
+    // while (1) {
+    // int all_done = 1;
+    // for(t = ptable.proc; t < &ptable.proc[NPROC]; t++) {
+    //     if(t->main_thread == proc && t->is_spawned_thread && t->state != ZOMBIE) {
+    //         all_done = 0;
+    //         break;
+    //     }
+    // }
+    // if (all_done)
+    //     break;
+    // sleep(proc, &ptable.lock);
+    // }
+
+
+
+    // Parent might be sleeping in wait().
+    wakeup1(myproc()->parent);
+
+    // Pass abandoned children to init.
+    while ((p = myproc()->children) != 0)
+    {
+        kin_remove(p);
+        p->parent = initproc;
+        kin_insert(p);
+    }
+
+    if (myproc()->zombies != 0)
+    {
+        while ((p = myproc()->zombies) != 0)
+        {
+            kin_remove(p);
+            p->parent = initproc;
+            kin_insert(p);
+        }
+
+        wakeup1(initproc);
+    }
+
+    // Jump into the scheduler, never to return. Move to the parent's
+    // list of zombie children on the way.
+    kin_remove(myproc());
+    setstate(myproc(), ZOMBIE);
+    kin_insert(myproc());
+    sched_unlock();
+
+    panic("zombie exit");
+}
+
+// Free a ZOMBIE child. Caller must hold ptable.lock.
+static void reap(struct proc *p)
+{
+    kin_remove(p);
+    oncpu_wait(p);
+    free_page(p->kstack);
+    p->kstack = 0;
+    freevm(p->pgdir);
+    setstate(p, UNUSED);
+    p->pid = 0;
+    p->parent = 0;
+    p->name[0] = 0;
+    p->killed = 0;
+}
+
+// Wait for a child process to exit and return its pid.
+// Return -1 if this process has no children.
+int wait(void)
+{
+    struct proc *p;
+    int pid;
+
+    acquire(&ptable.lock);
+
+    for (;;)
+    {
+        // Spawned threads are never on these lists.
+        if ((p = myproc()->zombies) != 0)
+        {
+            // Found one.
+            pid = p->pid;
+            reap(p);
+            release(&ptable.lock);
+
+            return pid;
+        }
+
+        // No point waiting if we don't have any children.
+        if (myproc()->children == 0 || myproc()->killed)
+        {
+            release(&ptable.lock);
+            return -1;
+        }
+
+        // Wait for children to exit.  (See wakeup1 call in proc_exit.)
+        sleep(myproc(), &ptable.lock); // DOC: wait-sleep
+    }
+}
+
+
+// Wait for the child process pid to exit and return its pid.
+// Return -1 if pid is not a child of this process.
+int waitpid(int pid)
+{
+    struct proc *p;
+
+    acquire(&ptable.lock);
+
+    for (;;)
+    {
+        p = findproc(pid);
+
+        if (p == 0 || p->parent != myproc() || p->is_thread || myproc()->killed)
+        {
+            release(&ptable.lock);
+            return -1;
+        }
+
+        if (p->state == ZOMBIE)
+        {
+            reap(p);
+            release(&ptable.lock);
+
+            return pid;
+        }
+
+        // exit() wakes the parent, see wait()
+        sleep(myproc(), &ptable.lock);
+    }
+}
+
+// Pull work over to CPU c from the busiest other run queue. An idle
+// CPU steals whatever it can get. Otherwise a process moves only if its
+// tickets are less than the gap between the two loads, which narrows
+// the gap: keeping the ticket loads of the CPUs level is what makes the
+// shares across CPUs follow the ticket ratios. The candidate is the
+// process the busiest queue would run next. The busiest queue is found
+// without the locks, and only it and ours are locked to move one.
+static void balance(int c)
+{
+    struct runq *rq, *busiest;
+    struct proc *p;
+    int i, load, max, gap;
+
+    rq = &ptable.rq[c];
+    busiest = 0;
+    max = 0;
+
+    for (i = 0; i < ncpu; i++)
+    {
+        load = runq_load(&ptable.rq[i]);
+
+        if (i != c && ptable.rq[i].nrun > 0 && load > max)
+        {
+            busiest = &ptable.rq[i];
+            max = load;
+        }
+    }
+
+    if (busiest == 0)
+    {
+        return;
+    }
+
+    runq_lock2(rq, busiest);
+
+    gap = runq_load(busiest) - runq_load(rq);
+
+    if ((p = sched_pick(busiest)) != 0 && !classes[p->sched]->pinned
+            && (rq->nrun == 0 || p->tickets < gap))
+    {
+        sched_dequeue(p);
+        p->cpu = c;
+        sched_enqueue(p);
+    }
+
+    runq_unlock2(rq, busiest);
+}
+
+// Make CPU c give up its process at the next interrupt from user mode.
+static void resched(int c)
+{
+    cpus[c].resched = 1;
+    kick(c);
+}
+
+// The threads of a process in gang mode, the main thread first.
+#define for_each_thread(t, m) \
+    for ((t) = (m); (t) != 0; (t) = ((t) == (m)) ? (m)->threads : (t)->sibnext)
+
+// Gang mode: the class picked w, whose main thread has gang mode on.
+// Start a gang round on CPU c: hand each other RUNNABLE thread of w
+// a slot on another CPU for the same time, so that threads waiting on
+// one another (e.g., at a barrier) are not stalled by a descheduled
+// sibling. A CPU already running one of the threads, or running a
+// real-time process or another gang, gives no slot. Threads left over
+// once the slots run out, and all of them with a single CPU, queue up
+// on c to run back to back after w, which keeps the address space
+// loaded. Only w won its pick: the others run on quanta they owe, which
+// their class charges them (see the charge hook), so the round costs
+// the process as many picks as it ran threads and the group funding
+// still holds. Real-time threads run by their reservations, not in
+// gangs. Caller must hold ptable.lock, for the threads of w, and no run
+// queue lock: each run queue is locked in turn.
+static void gang_start(int c, struct proc *w)
+{
+    struct runq *rq;
+    struct proc *m, *t, *curr;
+    int slot[NCPU];
+    int i, k, n;
+
+    m = w->main_thread;
+    ptable.ganground++;
+
+    // the CPUs that may take a thread, c always last
+    n = 0;
+
+    for (i = 0; i < ncpu; i++)
+    {
+        rq = &ptable.rq[i];
+        curr = rq->curr;
+
+        if (i != c && rq->gang == 0 && (curr == 0
+                || (curr->main_thread != m && curr->sched != SCHED_EDF)))
+        {
+            slot[n++] = i;
+        }
+    }
+
+    slot[n++] = c;
+
+    k = 0;
+
+    for_each_thread(t, m)
+    {
+        if (t == w || t->state != RUNNABLE || t->parked
+                || t->sched == SCHED_EDF)
+        {
+            continue;
+        }
+
+        if (classes[t->sched]->pinned)
+        {
+            i = t->cpu;     // runs in its CPU's round, if that has one
+        }
+        else
+        {
+            i = slot[k++ % n];
+
+            if (!runq_move(t, i))
+            {
+                continue;   // it got to run meanwhile
+            }
+        }
 
-    // Clear r0 so that fork returns 0 in the child.
-    np->tf->r0 = 0;
+        rq = &ptable.rq[i];
 
-    for (i = 0; i < NOFILE; i++)
-    {
-        if (proc->ofile[i])
+        acquire(&rq->lock);
+
+        // the CPU may be busy with another gang
+        if ((rq->gang == 0 || rq->ganground != ptable.ganground)
+                && (i == c || rq->gang == 0 || rq->gang == m))
         {
-            np->ofile[i] = filedup(proc->ofile[i]);
-        }
-    }
+            rq->gang = m;
+            rq->ganground = ptable.ganground;
 
-    np->cwd = idup(proc->cwd);
+            if (i != c)
+            {
+                resched(i);
+            }
+        }
 
-    pid = np->pid;
-    np->state = RUNNABLE;
-    safestrcpy(np->name, proc->name, sizeof(proc->name));
+        release(&rq->lock);
+    }
 
-    // np->tickets = proc->tickets > 0 ? proc->tickets : 1;
-    // np->runticks = 0;
-    // np->boostsleft = 0;
+    rq = &ptable.rq[c];
 
-    return pid;
+    acquire(&rq->lock);
+    rq->gang = m;
+    rq->ganground = ptable.ganground;
+    release(&rq->lock);
 }
 
-// Exit the current process.  Does not return.
-// An exited process remains in the zombie state
-// until its parent calls wait() to find out it exited.
-void exit(void)
+// The next thread to run in the gang round of CPU c, if one is still
+// queued there; the round is over otherwise. Caller must hold
+// ptable.lock and the lock of rq.
+static struct proc *gang_next(struct runq *rq, int c)
 {
-    struct proc *p;
-    int fd;
-    
-    if (proc == initproc)
+    struct proc *m, *t;
+
+    if ((m = rq->gang) == 0)
     {
-        panic("init exiting");
+        return 0;
     }
 
-    // Close all open files.
-    for (fd = 0; fd < NOFILE; fd++)
+    if (m->gang)
     {
-        if (proc->ofile[fd])
+        for_each_thread(t, m)
         {
-            fileclose(proc->ofile[fd]);
-            proc->ofile[fd] = 0;
+            if (t->state == RUNNABLE && !t->parked && t->cpu == c
+                    && t->sched != SCHED_EDF && t->ganground != rq->ganground)
+            {
+                return t;
+            }
         }
     }
 
-    iput(proc->cwd);
-    proc->cwd = 0;
+    rq->gang = 0;
 
-    acquire(&ptable.lock);
+    return 0;
+}
 
-    // struct proc *t;
-    // // for(t = ptable.proc; t < &ptable.proc[NPROC]; t++) {
-    // //     if(t->main_thread == proc && t->is_spawned_thread && t->state != ZOMBIE) {
-    // //         sleep(proc, &ptable.lock);
-    // //     }
-    // // }
-    // while (1) {
-    // int all_done = 1;
-    // for(t = ptable.proc; t < &ptable.proc[NPROC]; t++) {
-    //     if(t->main_thread == proc && t->is_spawned_thread && t->state != ZOMBIE) {
-    //         all_done = 0;
-    //         break;
-    //     }
-    // }
-    // if (all_done)
-    //     break;
-    // sleep(proc, &ptable.lock);
-    // }
+// The process a directed yield (see yield_to) left to run next on rq,
+// if it is still queued there and no real-time process is due; 0
+// otherwise. It runs without a draw and uncharged: its caller paid.
+// Caller must hold the lock of rq.
+static struct proc *handoff(struct runq *rq, int c)
+{
+    struct proc *p;
 
+    p = rq->handoff;
+    rq->handoff = 0;
 
+    if (p == 0 || p->state != RUNNABLE || p->parked || p->cpu != c
+            || edf_class.pick_next(rq) != 0)
+    {
+        return 0;
+    }
 
-    // Parent might be sleeping in wait().
-    wakeup1(proc->parent);
+    return p;
+}
 
-    // Pass abandoned children to init.
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+// Whether CPU c may find a process to run: its run queue holds one, or
+// a gang round or a directed yield for it, or another run queue holds
+// one it could steal. Looks at the run queues under their own locks.
+static int runq_work(int c)
+{
+    struct runq *rq;
+    int i, work;
+
+    work = 0;
+
+    for (i = 0; i < ncpu && !work; i++)
     {
-        if (p->parent == proc)
-        {
-            p->parent = initproc;
+        rq = &ptable.rq[i];
 
-            if (p->state == ZOMBIE)
-            {
-                wakeup1(initproc);
-            }
-        }
+        acquire(&rq->lock);
+        work = rq->nrun > 0 || (i == c && (rq->gang != 0 || rq->handoff != 0));
+        release(&rq->lock);
     }
 
-    // Jump into the scheduler, never to return.
-    proc->state = ZOMBIE;
-    sched();
-
-    panic("zombie exit");
+    return work;
 }
 
-// Wait for a child process to exit and return its pid.
-// Return -1 if this process has no children.
-int wait(void)
+// Choose the process to run next on CPU c from its run queue rq, or 0
+// if there is none; its class charges it the quantum up front. Returns
+// with the lock of rq held. ptable.lock is only taken for a gang round,
+// which walks the threads of a process and deals them out to the CPUs.
+static struct proc *pick(struct runq *rq, int c)
 {
-    struct proc *p;
-    int havekids, pid;
+    struct proc *w, *t;
+    int gang, handed;
 
-    acquire(&ptable.lock);
+    gang = 0;   // whether we hold ptable.lock
 
     for (;;)
     {
-        // Scan through table looking for zombie children.
-        havekids = 0;
+        acquire(&rq->lock);
 
-        for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-        {
-            if (p->parent != proc || p->is_thread)
-                continue;  // skip spawned threads
+        t = 0;
+        handed = ((w = handoff(rq, c)) != 0);
 
-            havekids = 1;
+        if (!handed)
+        {
+            w = sched_pick(rq);
 
-            if (p->state == ZOMBIE)
+            // a process that owes quanta sits out as many of its picks
+            while (w != 0 && w->forfeit > 0)
             {
-                // Found one.
-                pid = p->pid;
-                free_page(p->kstack);
-                p->kstack = 0;
-                freevm(p->pgdir);
-                p->state = UNUSED;
-                p->pid = 0;
-                p->parent = 0;
-                p->name[0] = 0;
-                p->killed = 0;
-                release(&ptable.lock);
-
-                return pid;
+                w->forfeit--;
+                sched_dequeue(w);
+                sched_enqueue(w);
+                w = sched_pick(rq);
             }
         }
 
-        // No point waiting if we don't have any children.
-        if (!havekids || proc->killed)
+        // the threads of a gang round go first, on quanta they owe,
+        // but a real-time process keeps its precedence
+        if (!handed && w != 0 && w->sched != SCHED_EDF
+                && (rq->gang != 0 || w->main_thread->gang))
         {
-            release(&ptable.lock);
-            return -1;
-        }
-
-        // Wait for children to exit.  (See wakeup1 call in proc_exit.)
-        sleep(proc, &ptable.lock); // DOC: wait-sleep
-    }
-}
-
+            if (!gang)
+            {
+                release(&rq->lock);
+                acquire(&ptable.lock);
+                gang = 1;
+                continue;
+            }
 
-// PAGEBREAK: 42
-//  Per-CPU process scheduler.
-//  Each CPU calls scheduler() after setting itself up.
-//  Scheduler never returns.  It loops, doing:
-//   - choose a process to run
-//   - swtch to start running that process
-//   - eventually that process transfers control
-//       via swtch back to the scheduler.
-/* Put this at file scope (outside any other function) */
-struct proc* hold_lottery(int total_tickets) {
-    if (total_tickets <= 0)
-        return 0;
+            if ((t = gang_next(rq, c)) != 0)
+            {
+                w = t;
+            }
+            else if (w->main_thread->gang)
+            {
+                // not while we hold rq: gang_start locks the others
+                release(&rq->lock);
+                gang_start(c, w);
+                acquire(&rq->lock);
+
+                if (w->state != RUNNABLE || w->parked || w->cpu != c)
+                {
+                    release(&rq->lock);
+                    continue;   // it moved on meanwhile
+                }
+            }
+        }
 
-    int winning_ticket = rand() % total_tickets;
-    int current = 0;
+        // w may still be switching out on another CPU (e.g., woken as it
+        // went to sleep there). Wait for that without our lock, which
+        // that CPU may have to get first, then pick again.
+        if (w != 0 && w->oncpu)
+        {
+            if (handed)
+            {
+                rq->handoff = w;
+            }
 
-    struct proc *p;
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-        if (p->state != RUNNABLE)
+            release(&rq->lock);
+            oncpu_wait(w);
             continue;
+        }
 
-        int eff = p->tickets;
-        if (p->boostsleft > 0) eff *= 2;  // same effective tickets logic
-        current += eff;
+        break;
+    }
 
-        if (current > winning_ticket) {
-            return p; // winner found
+    if (w != 0 && !handed)
+    {
+        if (t != 0)
+        {
+            classes[w->sched]->charge(rq, w);
+        }
+        else
+        {
+            classes[w->sched]->tick(rq, w);
         }
     }
 
-    return 0;
+    if (gang)
+    {
+        release(&ptable.lock);
+    }
+
+    return w;
 }
 
+// Nothing is RUNNABLE: instead of spinning, stop the periodic tick,
+// arm the timer for the earliest sleepfor() deadline and wait for an
+// interrupt. Called with the lock of rq held, returns with it released.
+static void idle(struct runq *rq)
+{
+    int next;
 
+    next = 0;   // no deadline
 
+    // only the boot CPU takes timer interrupts and passes the tick on,
+    // so it can only stop the tick when there are no other CPUs. Then,
+    // with interrupts off, nothing changes what we look at here.
+    if (ncpu == 1)
+    {
+        // queued processes that may not run yet (e.g., out of real-time
+        // budget), and parked ones, need the tick to become eligible
+        if (rq->nrun > 0 || ptable.nthrottled > 0)
+        {
+            next = 1;
+        }
+        else if (ptable.timers.n > 0)
+        {
+            next = ptable.timers.slot[0]->sleeptarget - ticks;
 
+            if (next <= 0)
+            {
+                next = 1;
+            }
+        }
+    }
 
+    // keep interrupts off until we are in wfi: an interrupt that arrives
+    // in between stays pending and wakes us up immediately.
+    pushcli();
+    release(&rq->lock);
 
+    if (ncpu == 1)
+    {
+        timer_idle(next);
+    }
 
+    wfi();
 
+    popcli();   // the pending interrupt is taken here
+    timer_resume();
+}
 
-/* Replace your existing scheduler() with this */
+// PAGEBREAK: 42
+//  Per-CPU process scheduler.
+//  Each CPU calls scheduler() after setting itself up.
+//  Scheduler never returns.  It loops, doing:
+//   - choose a process to run
+//   - swtch to start running that process
+//   - eventually that process transfers control
+//       via swtch back to the scheduler.
+//  Only the lock of the CPU's run queue is held across the switch; the
+//  process gives it back when it switches away.
 void scheduler(void)
 {
-    struct proc *p;
+    struct runq *rq;
+    struct proc *winner;
+    int c;
+
+    c = mycpu()->id;
+    rq = &ptable.rq[c];
 
     for (;;) {
         sti();                      // enable interrupts on this processor
 
-        acquire(&ptable.lock);
+        // nothing to run here or to steal: wait for an interrupt. Interrupts
+        // stay off until wfi, so a kick after the check still wakes us.
+        if (ncpu > 1) {
+            pushcli();
 
-        /* compute total effective tickets for this round */
-        int total = 0;
-        for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-            if (p->state != RUNNABLE)
+            if (!runq_work(c)) {
+                wfi();
+                popcli();
                 continue;
-            int eff = p->tickets;
-            if (p->boostsleft > 0) eff *= 2; // boosted priority
-            total += eff;
-        }
-
-        /* Choose a process by lottery */
-        if(total>0){
-            struct proc *winner = hold_lottery(total);
-            if (winner != 0) {
-                proc = winner;
-                switchuvm(winner);
-                winner->state = RUNNING;
-                winner->runticks++;
-                if(winner->boostsleft>0){
-                    winner->boostsleft--;
-                }
-                /* switch to the chosen process */
-                swtch(&cpu->scheduler, proc->context);
-
-                /* coming back here after process yielded/exited/slept */
-                // switchuvm(0);
-                proc = 0;
             }
+
+            popcli();
+            balance(c);
         }
 
-        release(&ptable.lock);
+        if ((winner = pick(rq, c)) == 0) {
+            idle(rq);
+            continue;
+        }
+
+        winner->oncpu = 1;
+        mycpu()->proc = winner;
+        rq->curr = winner;
+
+        // a thread of the process that ran last shares its page
+        // table: the TLB and caches are still good, keep them
+        if (winner->pgdir != mycpu()->pgdir)
+            switchuvm(winner);
+
+        setrunstate(winner, RUNNING);
+        mycpu()->resched = 0;
+        if (rq->gang == winner->main_thread)
+            winner->ganground = rq->ganground;
+        winner->slicestart = ticks;
+        winner->sliceus = timer_usec();
+        winner->compfrac = 0;   // compensation lasts until it next runs
+        winner->runticks++;
+        if(winner->boostsleft>0){
+            winner->boostsleft--;
+        }
+        /* switch to the chosen process */
+        swtch(&mycpu()->scheduler, winner->context);
+
+        /* coming back here after process yielded/exited/slept */
+        // switchuvm(0);
+        rq->curr = 0;
+        mycpu()->proc = 0;
+
+        // its context is saved: let another CPU run it (see pick)
+        asm volatile("MCR p15, 0, %[r], c7, c10, 5" : : [r] "r"(0) : "memory");
+        winner->oncpu = 0;
+
+        release(&rq->lock);
     }
 }
 
 
-// Enter scheduler.  Must hold only ptable.lock
+// Enter scheduler.  Must hold only the lock of this CPU's run queue
 // and have changed proc->state.
 void sched(void)
 {
@@ -490,17 +2128,17 @@ void sched(void)
 
     // show_callstk ("sched");
 
-    if (!holding(&ptable.lock))
+    if (!holding(&ptable.rq[mycpu()->id].lock))
     {
-        panic("sched ptable.lock");
+        panic("sched runq lock");
     }
 
-    if (cpu->ncli != 1)
+    if (mycpu()->ncli != 1)
     {
         panic("sched locks");
     }
 
-    if (proc->state == RUNNING)
+    if (myproc()->state == RUNNING)
     {
         panic("sched running");
     }
@@ -510,18 +2148,65 @@ void sched(void)
         panic("sched interruptible");
     }
 
-    intena = cpu->intena;
-    swtch(&proc->context, cpu->scheduler);
-    cpu->intena = intena;
+    intena = mycpu()->intena;
+    swtch(&myproc()->context, mycpu()->scheduler);
+    mycpu()->intena = intena;
+}
+
+// Enter scheduler with ptable.lock held, the state of the current
+// process changed under it: trade it for the lock of this CPU's run
+// queue, which the switch needs. Returns holding neither, on whichever
+// CPU runs the process next.
+static void sched_unlock(void)
+{
+    runq_lock(myproc());
+    release(&ptable.lock);
+    sched();
+    release(&ptable.rq[mycpu()->id].lock);
 }
 
-// Give up the CPU for one scheduling round.
+// Give up the CPU for one scheduling round. Only the run queue is
+// locked: the process stays RUNNABLE, which no one else depends on.
 void yield(void)
 {
-    acquire(&ptable.lock); // DOC: yieldlock
-    proc->state = RUNNABLE;
+    runq_lock(myproc()); // DOC: yieldlock
+    setrunstate(myproc(), RUNNABLE);
     sched();
+    release(&ptable.rq[mycpu()->id].lock);
+}
+
+// Hand the CPU to process pid right away, without a draw: a waiter
+// can let the holder of a lock run instead of spinning its slice away.
+// pid runs for a quantum charged to the caller, which stays RUNNABLE.
+// Returns -1 if pid is not RUNNABLE (e.g., it runs on another CPU) or
+// may not move over to this CPU.
+int yield_to(int pid)
+{
+    struct runq *rq;
+    struct proc *p;
+
+    acquire(&ptable.lock);
+
+    p = findproc(pid);
+
+    if (p == 0 || p == myproc() || p->state != RUNNABLE || p->parked
+            || (p->cpu != mycpu()->id && classes[p->sched]->pinned)
+            || !runq_move(p, mycpu()->id))
+    {
+        release(&ptable.lock);
+        return -1;
+    }
+
+    rq = runq_lock(myproc());
     release(&ptable.lock);
+
+    rq->handoff = p;
+    classes[myproc()->sched]->charge(rq, myproc());
+    setrunstate(myproc(), RUNNABLE);
+    sched();
+    release(&ptable.rq[mycpu()->id].lock);
+
+    return 0;
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -530,8 +2215,8 @@ void forkret(void)
 {
     static int first = 1;
 
-    // Still holding ptable.lock from scheduler.
-    release(&ptable.lock);
+    // Still holding the lock of the run queue from scheduler.
+    release(&ptable.rq[mycpu()->id].lock);
 
     if (first)
     {
@@ -548,10 +2233,17 @@ void forkret(void)
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
 void sleep(void *chan, struct spinlock *lk)
+{
+    sleeplend(chan, lk, 0);
+}
+
+// sleep, lending our tickets to process pid (if not 0) until we wake
+// up: we wait for it, e.g., to write to a pipe or release a lock.
+void sleeplend(void *chan, struct spinlock *lk, int pid)
 {
     // show_callstk("sleep");
 
-    if (proc == 0)
+    if (myproc() == 0)
     {
         panic("sleep");
     }
@@ -571,56 +2263,234 @@ void sleep(void *chan, struct spinlock *lk)
         release(lk);
     }
 
-    // Go to sleep.
-    proc->chan = chan;
-    // proc->sleepticks = ticks;   // record global ticks when process goes to sleep
-    proc->state = SLEEPING;
-    sched();
+    // Go to sleep. A wakeup may come as soon as ptable.lock is gone,
+    // before we are off the CPU; see pick for how that is handled.
+    myproc()->chan = chan;
+    lend(myproc(), pid);
+    // proc->sleepticks = ticks;   // record global ticks when process goes to sleep
+    setstate(myproc(), SLEEPING);
+    sched_unlock();
+
+    // Tidy up: no one looks at the channel of a process that runs.
+    myproc()->chan = 0;
+
+    // Reacquire original lock.
+    acquire(lk); // DOC: sleeplock2
+}
+
+// PAGEBREAK!
+//  Wake up all processes sleeping on chan. The ptable lock must be held.
+static void wakeup1(void *chan) {
+    struct proc *p, *next;
+
+    for(p = ptable.sleepq[sleepq_hash(chan)].head; p != 0; p = next) {
+        next = p->qnext;    // p leaves the queue if it wakes up
+
+        if(p->chan == chan)
+            setstate(p, RUNNABLE);
+    }
+}
+
+// Wake up all processes sleeping on chan.
+void wakeup(void *chan)
+{
+    acquire(&ptable.lock);
+    wakeup1(chan);
+    release(&ptable.lock);
+}
+
+// Wake up the longest sleeping process on chan, if any. The ptable
+// lock must be held.
+void wakeupone(void *chan)
+{
+    struct proc *p;
+
+    for (p = ptable.sleepq[sleepq_hash(chan)].head; p != 0; p = p->qnext)
+    {
+        if (p->chan == chan)
+        {
+            setstate(p, RUNNABLE);
+            p->chan = 0;
+            break;
+        }
+    }
+}
+
+// Sleep for n clock ticks. The process is parked on the timer heap and
+// timer_expire() makes it RUNNABLE once its deadline has passed, so
+// ticks on which no sleeper is due do not touch it at all.
+// Return -1 if the process was killed.
+int sleepfor(int n)
+{
+    if (n <= 0)
+    {
+        return 0;
+    }
+
+    acquire(&ptable.lock);
+
+    if (myproc()->killed)
+    {
+        release(&ptable.lock);
+        return -1;
+    }
+
+    myproc()->sleepticks = n;
+    myproc()->sleeptarget = ticks + n;
+    heap_insert(&ptable.timers, myproc());
+
+    sleep(&myproc()->sleeptarget, &ptable.lock);
+
+    release(&ptable.lock);
+
+    return myproc()->killed ? -1 : 0;
+}
+
+// Group g spent its quota: park its RUNNABLE members and take the CPU
+// from the running ones.
+static void group_throttle(struct group *g)
+{
+    struct runq *rq;
+    struct proc *m;
+
+    // set first: a member queued from now on parks itself (see
+    // sched_enqueue), those queued already are parked here
+    g->throttled = 1;
+    ptable.nthrottled++;
+
+    for (m = g->members; m != 0; m = m->gnext)
+    {
+        rq = runq_lock(m);
+
+        if (m->state == RUNNABLE && !m->parked)
+        {
+            sched_dequeue(m);
+            m->parked = 1;
+        }
+        else if (m->state == RUNNING)
+        {
+            resched(m->cpu);
+        }
+
+        release(&rq->lock);
+    }
+}
+
+// Let the members of group g run again.
+static void group_unthrottle(struct group *g)
+{
+    struct runq *rq;
+    struct proc *m;
+
+    g->throttled = 0;
+    ptable.nthrottled--;
+
+    for (m = g->members; m != 0; m = m->gnext)
+    {
+        rq = runq_lock(m);
 
-    // Tidy up.
-    proc->chan = 0;
+        if (m->parked)
+        {
+            m->parked = 0;
+            sched_enqueue(m);
+        }
 
-    // Reacquire original lock.
-    if (lk != &ptable.lock)
-    { // DOC: sleeplock2
-        release(&ptable.lock);
-        acquire(lk);
+        release(&rq->lock);
     }
 }
 
-// PAGEBREAK!
-//  Wake up all processes sleeping on chan. The ptable lock must be held.
-static void wakeup1(void *chan) {
+// Charge the tick to the groups with a quota whose members ran on the
+// CPUs, throttling those that spent it, and start the new periods.
+static void quota_tick(uint now)
+{
+    struct group *g;
     struct proc *p;
+    int i;
 
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-        if(p->state != SLEEPING || p->chan != chan)
+    for (g = ptable.groups; g < &ptable.groups[NGROUP]; g++)
+    {
+        if (g->id == 0 || g->quota == 0)
+        {
             continue;
+        }
 
-        if(chan == &ticks) {
-            // Wake only when requested sleep time has elapsed
-            if(ticks >= p->sleeptarget) {
-                // Give boosts = requested sleep duration
-                p->boostsleft += p->sleepticks;
+        if (g->throttled)
+        {
+            g->throttledticks++;
+        }
 
-                p->state = RUNNABLE;
+        if (now - g->pstart >= g->period)
+        {
+            g->pstart = now;
+            g->used = 0;
 
-                // Reset sleep info
-                p->sleepticks = 0;
-                p->sleeptarget = 0;
+            if (g->throttled)
+            {
+                group_unthrottle(g);
             }
-        } else {
-            // For I/O channels, wake immediately
-            p->state = RUNNABLE;
+        }
+    }
+
+    for (i = 0; i < ncpu; i++)
+    {
+        p = ptable.rq[i].curr;
+
+        if (p == 0 || (g = p->group) == 0 || g->quota == 0 || g->throttled)
+        {
+            continue;
+        }
+
+        if (++g->used >= g->quota)
+        {
+            group_throttle(g);
         }
     }
 }
 
-// Wake up all processes sleeping on chan.
-void wakeup(void *chan)
+// Wake the processes whose sleepfor() deadline is at or before now and
+// charge the groups with a quota. Called from the timer interrupt on
+// every tick.
+void timer_expire(uint now)
 {
+    struct proc *p;
+    int i;
+
     acquire(&ptable.lock);
-    wakeup1(chan);
+
+    quota_tick(now);
+
+    // a real-time process that ran out of budget mid-quantum gives the
+    // CPU up now
+    for (i = 0; i < ncpu; i++)
+    {
+        p = ptable.rq[i].curr;
+
+        if (p != 0 && p->sched == SCHED_EDF
+                && (int)(timer_usec() - p->sliceus) >= p->rtbudget)
+        {
+            resched(i);
+        }
+    }
+
+    while (ptable.timers.n > 0)
+    {
+        p = ptable.timers.slot[0];
+
+        if ((int)(now - p->sleeptarget) < 0)
+        {
+            break;
+        }
+
+        heap_remove(&ptable.timers, p);
+
+        // Give boosts = requested sleep duration
+        p->boostsleft += p->sleepticks;
+        p->sleepticks = 0;
+        p->sleeptarget = 0;
+
+        setstate(p, RUNNABLE);
+    }
+
     release(&ptable.lock);
 }
 
@@ -632,21 +2502,18 @@ int kill(int pid)
 
     acquire(&ptable.lock);
 
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if ((p = findproc(pid)) != 0)
     {
-        if (p->pid == pid)
-        {
-            p->killed = 1;
-
-            // Wake process from sleep if necessary.
-            if (p->state == SLEEPING)
-            {
-                p->state = RUNNABLE;
-            }
+        p->killed = 1;
 
-            release(&ptable.lock);
-            return 0;
+        // Wake process from sleep if necessary.
+        if (p->state == SLEEPING)
+        {
+            setstate(p, RUNNABLE);
         }
+
+        release(&ptable.lock);
+        return 0;
     }
 
     release(&ptable.lock);
@@ -668,9 +2535,12 @@ void procdump(void)
 
     struct proc *p;
     char *state;
+    int i;
 
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    for (i = 0; i < ptable.nslot; i++)
     {
+        p = ptable.proc[i];
+
         if (p->state == UNUSED)
         {
             continue;
@@ -706,7 +2576,7 @@ int ps(void)
         [ZOMBIE] "ZOMBIE"};
     acquire(&ptable.lock);
     cprintf("PID\tPPID\tNAME\t\tSTATE\t\tSYSTEMCALL\n");
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    for (p = nextlive(0); p != 0; p = nextlive(p))
     {
         if (p->state == UNUSED)
             continue;
@@ -718,7 +2588,9 @@ int ps(void)
 
 int settickets(int pid, int n)
 {
+    struct runq *rq;
     struct proc *p;
+    struct group *g;
     int ok=0;
 
     if (n <= 0)
@@ -726,14 +2598,45 @@ int settickets(int pid, int n)
 
     acquire(&ptable.lock);
 
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if ((p = findproc(pid)) != 0)
     {
-        if (p->pid == pid)
+        // the load of p's run queue counts its tickets
+        rq = runq_lock(p);
+
+        if (p->state == RUNNABLE)
         {
-            p->tickets = n;
-            ok=1;
-            break;
+            sched_dequeue(p);
+        }
+
+        if ((g = p->group) != 0)
+        {
+            if (active(p->state))
+            {
+                g->active += n - p->tickets;
+            }
+
+            // the main thread funds its thread group
+            if (g->anon && p == p->main_thread)
+            {
+                g->funding = n;
+            }
+        }
+
+        p->tickets = n;
+
+        if (p->state == RUNNABLE)
+        {
+            sched_enqueue(p);
+        }
+
+        release(&rq->lock);
+
+        if (g)
+        {
+            group_reweigh(g, p);
         }
+
+        ok=1;
     }
 
     release(&ptable.lock);
@@ -741,27 +2644,312 @@ int settickets(int pid, int n)
     return ok ? 0: -1;
 }
 
-int getpinfo(struct pstat *ps)
+// Move p over to scheduler class c. Caller must hold ptable.lock.
+static void setclass(struct proc *p, int c)
+{
+    struct runq *rq;
+
+    rq = runq_lock(p);
+
+    if (p->state == RUNNABLE)
+    {
+        sched_dequeue(p);
+    }
+
+    if (p->sched != c)
+    {
+        class_exit(p);
+        p->forfeit = 0;     // owed in the old class's terms
+        class_enter(p, c);
+    }
+
+    p->sched = c;
+
+    if (p->state == RUNNABLE)
+    {
+        sched_enqueue(p);
+    }
+
+    release(&rq->lock);
+}
+
+// Switch the scheduler class of process pid to policy, or the
+// system-wide class if pid is 0. A process can only be given a class of
+// its own if the class allows it (perproc), or go back to the system-
+// wide one. Switching the system-wide class moves every process that
+// follows it. Returns the previous class, or -1 if policy is unknown or
+// not allowed, or there is no such process.
+int setsched(int pid, int policy)
+{
+    struct proc *p;
+    int old;
+
+    // the real-time class takes parameters, see setrt
+    if (policy < 0 || policy >= NSCHED || policy == SCHED_EDF)
+        return -1;
+
+    acquire(&ptable.lock);
+
+    if (pid == 0)
+    {
+        if (classes[policy]->perproc)
+        {
+            release(&ptable.lock);
+            return -1;
+        }
+
+        old = ptable.policy;
+        ptable.policy = policy;
+
+        for (p = nextlive(0); p != 0; p = nextlive(p))
+        {
+            if (!classes[p->sched]->perproc)
+                setclass(p, policy);
+        }
+    }
+    else
+    {
+        if ((p = findproc(pid)) == 0 ||
+            (policy != ptable.policy && !classes[policy]->perproc))
+        {
+            release(&ptable.lock);
+            return -1;
+        }
+
+        old = p->sched;
+        setclass(p, policy);
+    }
+
+    release(&ptable.lock);
+
+    return old;
+}
+
+// Make the current process a periodic real-time process that runs for
+// runtime ticks in every period ticks, done by deadline ticks into the
+// period, or with runtime 0, put it back into the system-wide class.
+// Admission control places it on the first CPU with the bandwidth left,
+// starting with its own. Returns -1 if no CPU has, or the parameters
+// are invalid; the process then keeps its previous parameters.
+int setrt(int runtime, int period, int deadline)
 {
+    struct runq *rq, *own;
     struct proc *p;
-    int i = 0;
-    if (ps == 0)
+    int i, c, freed;
+
+    if (runtime == 0)
+    {
+        acquire(&ptable.lock);
+        setclass(myproc(), ptable.policy);
+        release(&ptable.lock);
+        return 0;
+    }
+
+    if (runtime < 0 || deadline < runtime || period < deadline)
+        return -1;
+
+    p = myproc();
+
+    acquire(&ptable.lock);
+
+    own = &ptable.rq[p->cpu];
+
+    for (i = 0; i < ncpu; i++)
+    {
+        c = (p->cpu + i) % ncpu;
+        rq = &ptable.rq[c];
+
+        // an old reservation on the same CPU makes way for the new one
+        freed = (p->sched == SCHED_EDF && p->cpu == c) ? edf_bw(p) : 0;
+
+        runq_lock2(own, rq);
+
+        if (edf_admit(rq, freed, runtime, period, deadline) == 0)
+        {
+            // leave the old class (and reservation) on the old
+            // parameters, join EDF on CPU c with the new ones; the
+            // process runs, so it is on no run queue. See setclass.
+            class_exit(p);
+            p->forfeit = 0;     // owed in the old class's terms
+            p->rtruntime = runtime;
+            p->rtperiod = period;
+            p->rtdeadline = deadline;
+            p->cpu = c;
+            class_enter(p, SCHED_EDF);
+            p->sched = SCHED_EDF;
+
+            if (rq == own)
+            {
+                release(&rq->lock);
+                release(&ptable.lock);
+                return 0;
+            }
+
+            // the reservation is on another CPU: move over to it. c may
+            // pick us before we are off this CPU, see pick.
+            setrunstate(p, RUNNABLE);
+            release(&rq->lock);
+            release(&ptable.lock);
+            sched();
+            release(&ptable.rq[mycpu()->id].lock);
+
+            return 0;
+        }
+
+        runq_unlock2(own, rq);
+    }
+
+    // rejected: nothing changed, the old reservation (if any) stands
+    release(&ptable.lock);
+    return -1;
+}
+
+// Create a ticket group funded with funding base tickets and move the
+// current process into it. Returns the id of the group, or -1.
+int creategroup(int funding)
+{
+    struct group *g;
+
+    if (funding <= 0)
+        return -1;
+
+    acquire(&ptable.lock);
+
+    if ((g = group_alloc(0, funding)) == 0)
+    {
+        release(&ptable.lock);
+        return -1;
+    }
+
+    group_move(myproc(), g);
+    release(&ptable.lock);
+
+    return g->id;
+}
+
+// Set the funding of group id to funding base tickets.
+int fundgroup(int id, int funding)
+{
+    struct group *g;
+
+    if (funding <= 0)
+        return -1;
+
+    acquire(&ptable.lock);
+
+    if ((g = group_find(id)) == 0)
+    {
+        release(&ptable.lock);
+        return -1;
+    }
+
+    g->funding = funding;
+    group_reweigh(g, 0);
+    release(&ptable.lock);
+
+    return 0;
+}
+
+// Cap group id at quota ticks of CPU time in every period of period
+// ticks, summed over the CPUs; quota 0 lifts the cap.
+int setquota(int id, int quota, int period)
+{
+    struct group *g;
+
+    if (quota < 0 || period <= 0)
+        return -1;
+
+    acquire(&ptable.lock);
+
+    if ((g = group_find(id)) == 0)
+    {
+        release(&ptable.lock);
         return -1;
+    }
+
+    if (g->throttled)
+    {
+        group_unthrottle(g);
+    }
+
+    g->quota = quota;
+    g->period = period;
+    g->used = 0;
+    g->pstart = ticks;
+    release(&ptable.lock);
+
+    return 0;
+}
+
+// Move process pid into group id, or out of any group if id is 0.
+int setgroup(int pid, int id)
+{
+    struct proc *p;
+    struct group *g;
 
     acquire(&ptable.lock);
 
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++, i++)
+    g = group_find(id);
+
+    if ((p = findproc(pid)) == 0 || (id != 0 && g == 0))
     {
-        ps->inuse[i] = (p->state != UNUSED);
-        ps->pid[i] = p->pid;
-        ps->tickets[i] = p->tickets;
-        ps->runticks[i] = p->runticks;
-        ps->boostsleft[i] = p->boostsleft;
+        release(&ptable.lock);
+        return -1;
     }
+
+    group_move(p, g);
+    release(&ptable.lock);
+
+    return 0;
+}
+
+// Turn gang mode on or off for the threads of the current process.
+int setgang(int on)
+{
+    acquire(&ptable.lock);
+    myproc()->main_thread->gang = (on != 0);
     release(&ptable.lock);
+
     return 0;
 }
 
+// Copy a struct pstat for each live process, up to n of them, out to
+// the array at user address uva. Returns the number of entries filled.
+int getpinfo(uint uva, int n)
+{
+    struct proc *p;
+    struct pstat st;
+    int i;
+
+    if (n < 0)
+        return -1;
+
+    acquire(&ptable.lock);
+
+    for (p = nextlive(0), i = 0; p != 0 && i < n; p = nextlive(p), i++)
+    {
+        st.pid = p->pid;
+        st.tickets = p->tickets;
+        st.runticks = p->runticks;
+        st.boostsleft = p->boostsleft;
+        st.sched = p->sched;
+        st.rtmisses = p->rtmisses;
+        st.group = p->group ? p->group->id : 0;
+        st.borrowed = p->borrowed;
+        st.runus = p->runus;
+        st.throttled = p->group ? p->group->throttledticks : 0;
+
+        if (copyout(myproc()->pgdir, uva + i * sizeof(st), &st, sizeof(st)) < 0)
+        {
+            release(&ptable.lock);
+            return -1;
+        }
+    }
+
+    release(&ptable.lock);
+    return i;
+}
+
 
 // thread_create(uint *tid_ptr, void (*func)(void*), void *arg)
 // int
@@ -885,6 +3073,7 @@ int getpinfo(struct pstat *ps)
 int thread_create(uint *tid_ptr, void (*func)(void*), void *arg)
 {
     struct proc *np;
+    struct group *g;
     uint sp, stack_addr;
 
     // Allocate process struct for new thread
@@ -892,25 +3081,27 @@ int thread_create(uint *tid_ptr, void (*func)(void*), void *arg)
         return -1;
 
     // Share address space (page table)
-    np->pgdir = proc->pgdir;
-    np->sz = proc->sz;
+    np->pgdir = myproc()->pgdir;
+    np->sz = myproc()->sz;
 
     // Set mainthread/main process pointer
-    np->main_thread = proc->is_thread ? proc->main_thread : proc;
+    np->main_thread = myproc()->is_thread ? myproc()->main_thread : myproc();
     np->is_thread = 1;
 
     // Prepare trapframe for new thread based on parent
-    *np->tf = *proc->tf;
+    *np->tf = *myproc()->tf;
 
     // Allocate one user page aligned at the next page boundary
-    stack_addr = PGROUNDUP(proc->sz);
+    stack_addr = PGROUNDUP(myproc()->sz);
     if (allocuvm(np->pgdir, stack_addr, stack_addr + PGSIZE) == 0) {
-        np->state = UNUSED;
+        acquire(&ptable.lock);
+        setstate(np, UNUSED);
+        release(&ptable.lock);
         return -1;
     }
     np->ustack_base = (void*)stack_addr;
     np->sz = stack_addr + PGSIZE;
-    proc->sz += PGSIZE; // Ensure parent tracks new memory too
+    myproc()->sz += PGSIZE; // Ensure parent tracks new memory too
 
     // Initialize user stack pointer (top of stack page)
     sp = stack_addr + PGSIZE;
@@ -930,82 +3121,97 @@ int thread_create(uint *tid_ptr, void (*func)(void*), void *arg)
 
     // All open files & cwd
     for (int i = 0; i < NOFILE; i++) {
-        if (proc->ofile[i])
-            np->ofile[i] = filedup(proc->ofile[i]);
+        if (myproc()->ofile[i])
+            np->ofile[i] = filedup(myproc()->ofile[i]);
     }
-    np->cwd = idup(proc->cwd);
+    np->cwd = idup(myproc()->cwd);
 
     // Ready
-    np->parent = proc;
-    np->state = RUNNABLE;
+    acquire(&ptable.lock);
+    np->parent = myproc();
+    kin_insert(np);
+
+    // the threads of a process share a ticket group funded with the
+    // tickets of the main thread, so they get no more CPU together than
+    // the process would alone
+    if (np->main_thread->group == 0 &&
+        (g = group_alloc(1, np->main_thread->tickets)) != 0)
+    {
+        group_move(np->main_thread, g);
+    }
+
+    if (np->main_thread->group)
+    {
+        group_join(np, np->main_thread->group);
+    }
+
+    setstate(np, RUNNABLE);
+    release(&ptable.lock);
 
     // Assign thread id out
-    if (copyout(proc->pgdir, (uint)tid_ptr, (void*)&(np->pid), sizeof(np->pid)) < 0)
+    if (copyout(myproc()->pgdir, (uint)tid_ptr, (void*)&(np->pid), sizeof(np->pid)) < 0)
         return -1;
 
-    safestrcpy(np->name, proc->name, sizeof(np->name));
+    safestrcpy(np->name, myproc()->name, sizeof(np->name));
     return np->pid;
 }
 
 void thread_exit(void) {
     int fd;
 
-    if (!proc->is_thread)
+    if (!myproc()->is_thread)
         return; // Only threads call thread_exit, else act as no-op
 
     // Close files
     for (fd = 0; fd < NOFILE; fd++) {
-        if (proc->ofile[fd]) {
-            fileclose(proc->ofile[fd]);
-            proc->ofile[fd] = 0;
+        if (myproc()->ofile[fd]) {
+            fileclose(myproc()->ofile[fd]);
+            myproc()->ofile[fd] = 0;
         }
     }
-    iput(proc->cwd);
-    proc->cwd = 0;
+    iput(myproc()->cwd);
+    myproc()->cwd = 0;
 
     acquire(&ptable.lock);
     // Wake up main thread if it's waiting in join
-    wakeup1(proc->main_thread);
+    wakeup1(myproc()->main_thread);
 
     // Mark as ZOMBIE, scheduler will free stack in join
-    proc->state = ZOMBIE;
-    sched();
+    setstate(myproc(), ZOMBIE);
+    sched_unlock();
     panic("zombie exit");
 }
 
 int thread_join(uint tid) {
     struct proc *p;
+    uint stack;
     int found = 0;
 
     acquire(&ptable.lock);
     for (;;) {
         found = 0;
-        for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-            if (p->pid == tid && p->main_thread == proc && p->is_thread) {
-                found = 1;
-                if (p->state == ZOMBIE) {
-                    // Free stack
-                    if (p->ustack_base)
-                        deallocuvm(proc->pgdir, (uint)p->ustack_base + PGSIZE, (uint)p->ustack_base);
-
-                    free_page(p->kstack);
-                    p->state = UNUSED;
-                    p->pid = 0;
-                    p->parent = 0;
-                    p->main_thread = 0;
-                    p->name[0] = 0;
-                    p->killed = 0;
-                    release(&ptable.lock);
-                    return tid;
+        p = findproc(tid);
+        if (p != 0 && p->main_thread == myproc() && p->is_thread) {
+            found = 1;
+            if (p->state == ZOMBIE) {
+                stack = (uint)p->ustack_base;
+                thread_reap(p);
+                release(&ptable.lock);
+
+                // Free stack. Not under ptable.lock: the other CPUs
+                // running threads must take the TLB shootdown.
+                if (stack) {
+                    shrinkuvm(myproc(), stack + PGSIZE, stack);
                 }
+                return tid;
             }
         }
-        if (!found || proc->killed) {
+        if (!found || myproc()->killed) {
             release(&ptable.lock);
             return -1;
         }
         // Wait for thread to exit
-        sleep(proc, &ptable.lock);
+        sleep(myproc(), &ptable.lock);
     }
 }
 
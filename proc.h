@@ -1,7 +1,7 @@
 #ifndef PROC_INCLUDE_
 #define PROC_INCLUDE_
 
-// Per-CPU state, now we only support one CPU
+// Per-CPU state
 struct cpu
 {
     uchar id;                  // index into cpus[] below
@@ -11,16 +11,36 @@ struct cpu
     int ncli;   // Depth of pushcli nesting.
     int intena; // Were interrupts enabled before pushcli?
 
-    // Cpu-local storage variables; see below
-    struct cpu *cpu;
-    struct proc *proc; // The currently-running process.
+    pde_t *pgdir;   // user page table in TTBR0, see switchuvm
+    uint asidgen;   // ASID generation the TLB was last flushed for
+    uint icachegen; // code generation the I-cache was last invalidated for
+
+    volatile int resched;   // preempt at the next chance, see gang_start
+    volatile uint tlbshoot[NCPU];   // by sender: ASID to drop, see tlb_shootdown
+
+    struct proc *proc;      // the process running on it, 0 if none
 };
 
 extern struct cpu cpus[NCPU];
 extern int ncpu;
 
-extern struct cpu *cpu;
-extern struct proc *proc;
+// The CPU we are running on: TPIDRPRW, which only privileged modes can
+// read, points at its struct cpu (see cpu_init in main.c). The register
+// is read on every use, so a process that moved to another CPU while
+// switched out never sees its old one.
+static inline struct cpu *mycpu(void)
+{
+    struct cpu *c;
+
+    asm volatile("MRC p15, 0, %[r], c13, c0, 4" : [r]"=r" (c));
+    return c;
+}
+
+// the process running on this CPU, 0 in the scheduler
+static inline struct proc *myproc(void)
+{
+    return mycpu()->proc;
+}
 
 // PAGEBREAK: 17
 //  Saved registers for kernel context switches. The context switcher
@@ -60,6 +80,15 @@ enum procstate
     ZOMBIE
 };
 
+// heaps a process can be queued on (see struct pheap in sched.h)
+enum
+{
+    STRIDE_HEAP,    // RUNNABLE processes by pass
+    TIMER_HEAP,     // processes in sleepfor() by deadline
+    EDF_HEAP,       // real-time processes by deadline or next period
+    NHEAP
+};
+
 // Per-process state
 struct proc
 {
@@ -68,23 +97,77 @@ struct proc
     char *kstack;               // Bottom of kernel stack for this process
     enum procstate state;       // Process state
     volatile int pid;           // Process ID
+    int slot;                   // index in ptable.proc[]
     // volatile int tid;
     struct proc *parent;        // Parent process
+    struct proc *children;      // running children (not threads)
+    struct proc *zombies;       // exited children waiting to be reaped
+    struct proc *threads;       // threads spawned in this process group
+    struct proc *sibnext;       // next/previous process on the same
+    struct proc *sibprev;       //   children, zombies or threads list
     struct trapframe *tf;       // Trap frame for current syscall
     struct context *context;    // swtch() here to run process
     void *chan;                 // If non-zero, sleeping on chan
+    struct proc *qnext;         // next/previous sleeper in the same
+    struct proc *qprev;         //   sleep queue bucket
+    struct proc *snext;         // next/previous process in the
+    struct proc *sprev;         //   same state
+    struct proc *pidnext;       // next process in the same pid hash bucket
     int killed;                 // If non-zero, have been killed
     struct file *ofile[NOFILE]; // Open files
     struct inode *cwd;          // Current directory
     char name[16];              // Process name (debugging)
     int syscall_count;          // Number of syscalls made Processes
     int tickets;
+    int sched;                  // scheduler class, SCHED_* (see sched.h)
+    struct group *group;        // ticket group whose currency the tickets
+                                //   are in, 0 for the base currency
+    struct proc *gnext;         // next/previous member of the group
+    struct proc *gprev;
+    int borrowed;               // tickets lent to it by blocked processes
+    int lent;                   // tickets it lends while asleep, to
+    struct proc *lendto;        //   lendto, if that is still process
+    int lendpid;                //   lendpid
+    int efftickets;             // effective tickets while queued
+    int forfeit;                // picks to sit out for quanta owed,
+                                //   see the charge hook in sched.h
+    uint pass;                  // stride: virtual time consumed so far
+    int heapidx[NHEAP];         // position in the heaps above, -1 if not queued
+    struct proc *rnext;         // next/previous process in the same
+    struct proc *rprev;         //   MLFQ level
+    int mlfqlevel;              // MLFQ priority level, 0 is the highest
+    int mlfqstart;              // runticks when it entered the level
+    uint mlfqepoch;             // MLFQ boost period it was last reset in
+    int rtruntime;              // EDF: ticks to run in each period
+    int rtperiod;               // EDF: period, in ticks
+    int rtdeadline;             // EDF: deadline, ticks into the period
+    int rtbudget;               // EDF: microseconds left to run in this
+                                //   period
+    uint rtstart;               // EDF: tick the current period starts at
+    int rtthrottled;            // EDF: waiting for its next period
+    int rtmisses;               // EDF: deadlines missed
+    int cpu;                    // CPU whose run queue holds the process
+    volatile int oncpu;         // its context is in use by a CPU, from
+                                //   the switch to it to the one back
+    int gang;                   // main thread: coschedule its threads
+    int parked;                 // RUNNABLE, but held off the run queue
+                                //   while its group is throttled
+    uint ganground;             // gang round it last ran in
+    uint asid;                  // ASID (with generation) of the address
+                                //   space, kept by the main thread
+    uint tlbcpus;               // main thread: CPUs that may hold TLB
+                                //   entries tagged with the ASID
     int runticks;
     int boostsleft;
     int sleepticks;             //when process went to sleep
     int sleepticks_total;       //total ticks slep   
     int sleeptarget;
     int sleepleft;              // remaining ticks to sleep
+    uint slicestart;            // tick at which the current time slice began
+    uint sliceus;               // timer_usec() at which it began
+    uint runus;                 // CPU time used, in microseconds
+    int compfrac;               // per mille of the quantum it used before
+                                //   it blocked, 0 if not compensated
 
       // Flag: 1 if this is a spawned thread (created by thread_create), 0 otherwise.
     int is_thread; 
@@ -100,7 +183,7 @@ struct proc
 };
 
 // int settickets(int pid, int n);
-// int getpinfo(struct pstat *ps);
+// int getpinfo(struct pstat *ps, int n);
 
 // int thread_create(uint *tid_ptr, void (*func)(void*), void *arg);
 // void threads_exit(void);
@@ -0,0 +1,126 @@
+#ifndef SCHED_INCLUDE_
+#define SCHED_INCLUDE_
+
+// Scheduler classes. Each RUNNABLE process is queued on the run queue
+// of its CPU by the class it belongs to (p->sched). A class keeps its
+// own index of the processes in struct runq and is driven by proc.c
+// through the hooks below, all called with the lock of the run queue
+// held. ptable.lock may be held too, but need not be: picking, switching
+// and balancing take the run queue locks alone.
+//
+//   init       set up the class's part of a run queue at boot
+//   enqueue    p became RUNNABLE on rq
+//   dequeue    p left rq: it runs, sleeps, exits or moves to another CPU
+//   pick_next  the process the class would run next on rq, still queued
+//   tick       charge p for the quantum it is about to run
+//   account    p left the CPU after running for us microseconds
+//   charge     p owes a quantum it was not picked for: one it handed
+//              to another process (see yield_to) or runs in a gang round
+//   reweigh    effective_tickets(p) changed while p is queued
+//   enter      p joins the class: it was just created (p->parent set,
+//              not yet RUNNABLE), moves in from another class, or
+//              renews its real-time reservation (see setrt)
+//   exit       p leaves the class: it exits, moves to another class
+//              or renews its reservation
+//
+// enter, exit, account and reweigh are optional. Classes that charge
+// nothing up front (lottery, MLFQ) charge an owed quantum by having the
+// process forfeit its next pick (p->forfeit, see scheduler).
+//
+// A class either applies to the whole system or, if perproc is set,
+// may also be chosen for single processes next to the system-wide one
+// (see setsched). The processes of a pinned class stay on the CPU they
+// were placed on. When the run queue holds processes of several
+// classes, the classes take precedence in the order given in proc.c.
+
+// a binary min-heap of processes. Each process records its position
+// in heap h in p->heapidx[h->key] (-1 if not queued) so that it can be
+// removed from the middle in O(log n). slot has room for NPROC, see
+// sched_page.
+struct pheap
+{
+    struct proc **slot;
+    int n;
+    int key;
+    int (*before)(struct proc *, struct proc *);
+};
+
+// a run queue: the RUNNABLE processes assigned to one CPU. Its fields
+// change only with lock held; the CPU picks from it, and the others
+// steal from it, under that lock alone (see scheduler). The indexes of
+// the classes are allocated as the CPU comes up (see runq_init).
+struct runq
+{
+    struct spinlock lock;
+
+    int nrun;           // number of RUNNABLE processes queued
+    int load;           // sum of their tickets, for balancing
+    struct proc *curr;  // the process running on the CPU, if any
+
+    // lottery class: a Fenwick (binary indexed) tree over the effective
+    // tickets of each slot, so a draw is a logarithmic descent instead of
+    // two scans of the whole table. Node i (1-based) is lottery[i - 1].
+    int *lottery;
+    int total;          // sum of effective tickets in the tree
+
+    // stride class: a binary min-heap of the processes ordered by pass
+    struct pheap stride;
+    uint pass;          // the pass of the last process picked
+
+    // MLFQ class: a FIFO of the processes at each priority level
+    struct
+    {
+        struct proc *head;
+        struct proc *tail;
+    } mlfq[MLFQ_LEVELS];
+    uint mlfqepoch;     // boost period the levels were last reset in
+
+    // EDF class: the processes with budget left by absolute deadline,
+    // and those waiting for their next period by its start
+    struct pheap edf;
+    struct pheap rtwait;
+    int rtbw;           // bandwidth admitted to the CPU, see edf_admit
+
+    // gang mode: the main thread whose threads this CPU runs in the
+    // current gang round, and the round (see gang_start)
+    struct proc *gang;
+    uint ganground;
+
+    struct proc *handoff;   // directed yield: run next, see yield_to
+};
+
+struct sched_class
+{
+    char *name;
+    int perproc;        // can be set for single processes
+    int pinned;         // processes never move to another CPU
+
+    void (*init)(struct runq *rq);
+    void (*enqueue)(struct runq *rq, struct proc *p);
+    void (*dequeue)(struct runq *rq, struct proc *p);
+    struct proc *(*pick_next)(struct runq *rq);
+    void (*tick)(struct runq *rq, struct proc *p);
+    void (*account)(struct runq *rq, struct proc *p, int us);
+    void (*charge)(struct runq *rq, struct proc *p);
+    void (*reweigh)(struct runq *rq, struct proc *p);
+    void (*enter)(struct runq *rq, struct proc *p);
+    void (*exit)(struct runq *rq, struct proc *p);
+};
+
+extern struct sched_class lottery_class;
+extern struct sched_class stride_class;
+extern struct sched_class mlfq_class;
+extern struct sched_class edf_class;
+
+// sched_edf.c
+int edf_admit(struct runq *rq, int freed, int runtime, int period,
+              int deadline);
+int edf_bw(struct proc *p);
+
+// proc.c
+int effective_tickets(struct proc *p);
+void *sched_page(void);
+void heap_insert(struct pheap *h, struct proc *p);
+void heap_remove(struct pheap *h, struct proc *p);
+
+#endif
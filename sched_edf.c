@@ -0,0 +1,209 @@
+// Earliest deadline first, for periodic real-time processes. A process
+// declares (runtime, period, deadline) with setrt(): in every period it
+// may run for runtime ticks, which must be done by deadline ticks into
+// the period. The queued process with the earliest absolute deadline
+// runs, ahead of every other class.
+//
+// Admission control keeps the sum of runtime / min(deadline, period)
+// of the processes admitted to a CPU under RT_MAXBW, so EDF can meet
+// every deadline on it. Admitted processes stay on their CPU. The
+// budget is charged the time the process actually ran each time it
+// leaves the CPU, and the tick takes the CPU from one that runs out of
+// it mid-quantum; a process out of budget is throttled until its next
+// period starts. A process still queued with budget left when its
+// deadline passes has missed it; the miss is counted and the process
+// moves on to its next period.
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sched.h"
+
+// bandwidth of a reservation, in 1/RT_BWUNIT of a CPU
+static int edf_bandwidth(int runtime, int period, int deadline)
+{
+    int window;
+
+    window = deadline < period ? deadline : period;
+
+    return runtime * RT_BWUNIT / window;
+}
+
+int edf_bw(struct proc *p)
+{
+    return edf_bandwidth(p->rtruntime, p->rtperiod, p->rtdeadline);
+}
+
+// the budget of a whole period, in microseconds
+static int edf_runtime(struct proc *p)
+{
+    return p->rtruntime * (1000000 / HZ);
+}
+
+// absolute deadline of the current period
+static uint edf_deadline(struct proc *p)
+{
+    return p->rtstart + p->rtdeadline;
+}
+
+static int deadline_first(struct proc *a, struct proc *b)
+{
+    return (int)(edf_deadline(a) - edf_deadline(b)) < 0;
+}
+
+static int period_first(struct proc *a, struct proc *b)
+{
+    return (int)(a->rtstart - b->rtstart) < 0;
+}
+
+static void edf_init(struct runq *rq)
+{
+    rq->edf.slot = sched_page();
+    rq->edf.key = EDF_HEAP;
+    rq->edf.before = deadline_first;
+    rq->rtwait.slot = sched_page();
+    rq->rtwait.key = EDF_HEAP;
+    rq->rtwait.before = period_first;
+}
+
+// Move p on to the period that holds tick now, with a fresh budget, if
+// its current period is over.
+static void edf_newperiod(struct proc *p, uint now)
+{
+    uint n;
+
+    if ((int)(now - (p->rtstart + p->rtperiod)) < 0)
+    {
+        return;
+    }
+
+    n = (now - p->rtstart) / p->rtperiod;
+    p->rtstart += n * p->rtperiod;
+    p->rtbudget = edf_runtime(p);
+}
+
+// Queue p by its deadline, or wait for its next period if it has used
+// up its budget. rtwait is ordered by rtstart, which for a throttled
+// process is set to the start of the period it waits for.
+static void edf_enqueue(struct runq *rq, struct proc *p)
+{
+    edf_newperiod(p, ticks);
+
+    if (p->rtbudget <= 0)
+    {
+        p->rtstart += p->rtperiod;
+        p->rtbudget = edf_runtime(p);
+    }
+
+    p->rtthrottled = (int)(ticks - p->rtstart) < 0;
+    heap_insert(p->rtthrottled ? &rq->rtwait : &rq->edf, p);
+}
+
+static void edf_dequeue(struct runq *rq, struct proc *p)
+{
+    heap_remove(p->rtthrottled ? &rq->rtwait : &rq->edf, p);
+    p->rtthrottled = 0;
+}
+
+static struct proc *edf_pick(struct runq *rq)
+{
+    struct proc *p;
+    uint now;
+
+    now = ticks;
+
+    // throttled processes whose period has begun may run again
+    while (rq->rtwait.n > 0)
+    {
+        p = rq->rtwait.slot[0];
+
+        if ((int)(now - p->rtstart) < 0)
+        {
+            break;
+        }
+
+        heap_remove(&rq->rtwait, p);
+        p->rtthrottled = 0;
+        heap_insert(&rq->edf, p);
+    }
+
+    // deadlines passed with work left are misses
+    while (rq->edf.n > 0)
+    {
+        p = rq->edf.slot[0];
+
+        if ((int)(now - edf_deadline(p)) < 0)
+        {
+            return p;
+        }
+
+        p->rtmisses++;
+        heap_remove(&rq->edf, p);
+        p->rtbudget = 0;
+        edf_enqueue(rq, p);
+    }
+
+    return 0;
+}
+
+// nothing to charge up front: the budget pays for the time p runs
+static void edf_tick(struct runq *rq, struct proc *p)
+{
+}
+
+static void edf_account(struct runq *rq, struct proc *p, int us)
+{
+    p->rtbudget -= us;
+}
+
+// an owed quantum comes out of the budget
+static void edf_charge(struct runq *rq, struct proc *p)
+{
+    p->rtbudget -= QUANTUM * (1000000 / HZ);
+}
+
+// p was admitted with its parameters (see edf_admit): take its
+// bandwidth on the CPU and start its first period
+static void edf_enter(struct runq *rq, struct proc *p)
+{
+    rq->rtbw += edf_bw(p);
+    p->rtstart = ticks;
+    p->rtbudget = edf_runtime(p);
+    p->rtthrottled = 0;
+}
+
+// give the bandwidth of p back to its CPU
+static void edf_exit(struct runq *rq, struct proc *p)
+{
+    rq->rtbw -= edf_bw(p);
+}
+
+// Whether a reservation with the given parameters fits on the CPU of
+// rq once freed of the bandwidth admitted there is given back (the old
+// reservation of a process that renews its own). Returns 0 if it does,
+// -1 if not; changes nothing either way.
+int edf_admit(struct runq *rq, int freed, int runtime, int period,
+              int deadline)
+{
+    int bw;
+
+    bw = edf_bandwidth(runtime, period, deadline);
+
+    return rq->rtbw - freed + bw > RT_MAXBW ? -1 : 0;
+}
+
+struct sched_class edf_class = {
+    .name = "edf",
+    .perproc = 1,
+    .pinned = 1,
+    .init = edf_init,
+    .enqueue = edf_enqueue,
+    .dequeue = edf_dequeue,
+    .pick_next = edf_pick,
+    .tick = edf_tick,
+    .account = edf_account,
+    .charge = edf_charge,
+    .enter = edf_enter,
+    .exit = edf_exit,
+};
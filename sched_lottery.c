@@ -0,0 +1,105 @@
+// Lottery scheduling: every quantum, draw a ticket among the effective
+// tickets of the RUNNABLE processes; the holder runs. Over time each
+// process gets a share of the CPU proportional to its tickets.
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sched.h"
+
+// slot -> proc of the processes ever queued, slots are never reused
+static struct proc *slotproc[NPROC];
+static int top;     // largest power of two <= NPROC, start of the descent
+
+static void lottery_init(struct runq *rq)
+{
+    for (top = 1; top * 2 <= NPROC; top *= 2)
+        ;
+
+    rq->lottery = sched_page();
+}
+
+// add delta tickets to p's entry in the tree
+static void lottery_add(struct runq *rq, struct proc *p, int delta)
+{
+    int i;
+
+    rq->total += delta;
+
+    for (i = p->slot + 1; i <= NPROC; i += i & -i)
+    {
+        rq->lottery[i - 1] += delta;
+    }
+}
+
+static void lottery_enqueue(struct runq *rq, struct proc *p)
+{
+    slotproc[p->slot] = p;
+    p->efftickets = effective_tickets(p);
+    lottery_add(rq, p, p->efftickets);
+}
+
+static void lottery_dequeue(struct runq *rq, struct proc *p)
+{
+    lottery_add(rq, p, -p->efftickets);
+    p->efftickets = 0;
+}
+
+// Draw a lottery among the queued processes.
+static struct proc *lottery_pick(struct runq *rq)
+{
+    int winning_ticket, pos, step;
+
+    if (rq->total <= 0)
+        return 0;
+
+    winning_ticket = rand() % rq->total;
+    pos = 0;
+
+    // descend the Fenwick tree: find the first slot whose prefix sum
+    // of effective tickets exceeds the winning ticket.
+    for (step = top; step > 0; step >>= 1) {
+        if (pos + step <= NPROC && rq->lottery[pos + step - 1] <= winning_ticket) {
+            pos += step;
+            winning_ticket -= rq->lottery[pos - 1];
+        }
+    }
+
+    if (pos >= NPROC || slotproc[pos] == 0 || slotproc[pos]->state != RUNNABLE)
+        return 0;
+
+    return slotproc[pos]; // winner found
+}
+
+static void lottery_reweigh(struct runq *rq, struct proc *p)
+{
+    int eff;
+
+    eff = effective_tickets(p);
+    lottery_add(rq, p, eff - p->efftickets);
+    p->efftickets = eff;
+}
+
+// nothing to charge: the next draw is independent of this one
+static void lottery_tick(struct runq *rq, struct proc *p)
+{
+}
+
+// an owed quantum costs p the next draw it wins
+static void lottery_charge(struct runq *rq, struct proc *p)
+{
+    p->forfeit++;
+}
+
+struct sched_class lottery_class = {
+    .name = "lottery",
+    .perproc = 0,
+    .init = lottery_init,
+    .enqueue = lottery_enqueue,
+    .dequeue = lottery_dequeue,
+    .pick_next = lottery_pick,
+    .tick = lottery_tick,
+    .charge = lottery_charge,
+    .reweigh = lottery_reweigh,
+};
@@ -0,0 +1,169 @@
+// Multi-level feedback queue: RUNNABLE processes wait in a FIFO per
+// priority level and the first process of the highest non-empty level
+// runs. A process starts at the top level and moves down one level once
+// it has run for the allotment of its level (counted in runticks,
+// whether in one stretch or across many sleeps), so interactive
+// processes stay on top and CPU hogs sink. Every MLFQ_BOOST ticks all
+// processes go back to the top, so that none starves at the bottom.
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sched.h"
+
+// the boost period we are in
+static uint mlfq_epoch(void)
+{
+    return ticks / MLFQ_BOOST;
+}
+
+static void mlfq_reset(struct proc *p)
+{
+    p->mlfqlevel = 0;
+    p->mlfqstart = p->runticks;
+    p->mlfqepoch = mlfq_epoch();
+}
+
+static void mlfq_init(struct runq *rq)
+{
+    rq->mlfqepoch = mlfq_epoch();
+}
+
+// whatever p did in another class (or as a recycled proc) does not
+// count: it starts at the top with its full allotment
+static void mlfq_enter(struct runq *rq, struct proc *p)
+{
+    mlfq_reset(p);
+}
+
+// Queue p at the tail of its level. A process woken from sleepfor()
+// (it has sleep boosts left, see timer_expire) goes to the head instead.
+static void mlfq_enqueue(struct runq *rq, struct proc *p)
+{
+    int allot;
+
+    if (p->mlfqepoch != mlfq_epoch())
+    {
+        mlfq_reset(p);
+    }
+
+    allot = MLFQ_ALLOT << p->mlfqlevel;
+
+    if (p->mlfqlevel < MLFQ_LEVELS - 1 && p->runticks - p->mlfqstart >= allot)
+    {
+        p->mlfqlevel++;
+        p->mlfqstart = p->runticks;
+    }
+
+    if (p->boostsleft > 0)
+    {
+        p->rprev = 0;
+        p->rnext = rq->mlfq[p->mlfqlevel].head;
+
+        if (p->rnext)
+            p->rnext->rprev = p;
+        else
+            rq->mlfq[p->mlfqlevel].tail = p;
+
+        rq->mlfq[p->mlfqlevel].head = p;
+    }
+    else
+    {
+        p->rnext = 0;
+        p->rprev = rq->mlfq[p->mlfqlevel].tail;
+
+        if (p->rprev)
+            p->rprev->rnext = p;
+        else
+            rq->mlfq[p->mlfqlevel].head = p;
+
+        rq->mlfq[p->mlfqlevel].tail = p;
+    }
+}
+
+static void mlfq_dequeue(struct runq *rq, struct proc *p)
+{
+    if (p->rprev)
+        p->rprev->rnext = p->rnext;
+    else
+        rq->mlfq[p->mlfqlevel].head = p->rnext;
+
+    if (p->rnext)
+        p->rnext->rprev = p->rprev;
+    else
+        rq->mlfq[p->mlfqlevel].tail = p->rprev;
+
+    p->rnext = p->rprev = 0;
+}
+
+// Move everything queued on rq up to the top level, in level order.
+static void mlfq_boost(struct runq *rq)
+{
+    struct proc *p;
+    int l;
+
+    for (l = 1; l < MLFQ_LEVELS; l++)
+    {
+        if (rq->mlfq[l].head == 0)
+            continue;
+
+        for (p = rq->mlfq[l].head; p != 0; p = p->rnext)
+            mlfq_reset(p);
+
+        if (rq->mlfq[0].tail)
+            rq->mlfq[0].tail->rnext = rq->mlfq[l].head;
+        else
+            rq->mlfq[0].head = rq->mlfq[l].head;
+
+        rq->mlfq[l].head->rprev = rq->mlfq[0].tail;
+        rq->mlfq[0].tail = rq->mlfq[l].tail;
+        rq->mlfq[l].head = rq->mlfq[l].tail = 0;
+    }
+
+    // those at the top start over too
+    for (p = rq->mlfq[0].head; p != 0; p = p->rnext)
+        mlfq_reset(p);
+}
+
+static struct proc *mlfq_pick(struct runq *rq)
+{
+    int l;
+
+    if (rq->mlfqepoch != mlfq_epoch())
+    {
+        rq->mlfqepoch = mlfq_epoch();
+        mlfq_boost(rq);
+    }
+
+    for (l = 0; l < MLFQ_LEVELS; l++)
+    {
+        if (rq->mlfq[l].head)
+            return rq->mlfq[l].head;
+    }
+
+    return 0;
+}
+
+// the allotment is charged in runticks, which the scheduler counts
+static void mlfq_tick(struct runq *rq, struct proc *p)
+{
+}
+
+// an owed quantum costs p its next turn at its level
+static void mlfq_charge(struct runq *rq, struct proc *p)
+{
+    p->forfeit++;
+}
+
+struct sched_class mlfq_class = {
+    .name = "mlfq",
+    .perproc = 0,
+    .init = mlfq_init,
+    .enqueue = mlfq_enqueue,
+    .dequeue = mlfq_dequeue,
+    .pick_next = mlfq_pick,
+    .tick = mlfq_tick,
+    .charge = mlfq_charge,
+    .enter = mlfq_enter,
+};
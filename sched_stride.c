@@ -0,0 +1,81 @@
+// Stride scheduling: each process advances its pass by a stride
+// inversely proportional to its effective tickets every time it runs,
+// and the one with the minimum pass runs next. The shares follow the
+// ticket ratios deterministically, with an error of at most one quantum.
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sched.h"
+
+// pass values wrap around, compare them as a signed distance
+static int pass_before(struct proc *a, struct proc *b)
+{
+    return (int)(a->pass - b->pass) < 0;
+}
+
+static void stride_init(struct runq *rq)
+{
+    rq->stride.slot = sched_page();
+    rq->stride.key = STRIDE_HEAP;
+    rq->stride.before = pass_before;
+}
+
+// A process that joins the heap never starts behind the pass of the
+// queue, otherwise a long sleeper would monopolize the CPU to "catch up".
+static void stride_enqueue(struct runq *rq, struct proc *p)
+{
+    p->efftickets = effective_tickets(p);
+
+    if ((int)(p->pass - rq->pass) < 0)
+    {
+        p->pass = rq->pass;
+    }
+
+    heap_insert(&rq->stride, p);
+}
+
+static void stride_dequeue(struct runq *rq, struct proc *p)
+{
+    heap_remove(&rq->stride, p);
+    p->efftickets = 0;
+}
+
+static struct proc *stride_pick(struct runq *rq)
+{
+    return rq->stride.n > 0 ? rq->stride.slot[0] : 0;
+}
+
+// charge the quantum up front: the stride is inversely proportional to
+// the effective (boosted) tickets
+static void stride_tick(struct runq *rq, struct proc *p)
+{
+    rq->pass = p->pass;
+    p->pass += STRIDE1 / effective_tickets(p);
+}
+
+// an owed quantum advances the pass just the same; p was not picked,
+// so the pass of the queue stays
+static void stride_charge(struct runq *rq, struct proc *p)
+{
+    p->pass += STRIDE1 / effective_tickets(p);
+}
+
+// the heap is ordered by pass, the tickets only set the next stride
+static void stride_reweigh(struct runq *rq, struct proc *p)
+{
+    p->efftickets = effective_tickets(p);
+}
+
+struct sched_class stride_class = {
+    .name = "stride",
+    .perproc = 0,
+    .init = stride_init,
+    .enqueue = stride_enqueue,
+    .dequeue = stride_dequeue,
+    .pick_next = stride_pick,
+    .tick = stride_tick,
+    .charge = stride_charge,
+    .reweigh = stride_reweigh,
+};
@@ -12,13 +12,39 @@
 void initlock(struct spinlock *lk, char *name)
 {
     lk->name = name;
-    lk->locked = 0;
+    lk->next = 0;
+    lk->serving = 0;
     lk->cpu = 0;
 }
 
-// For single CPU systems, there is no need for spinlock.
-// Add the support when multi-processor is supported.
+// Data memory barrier: memory accesses before it are observed by the
+// other CPUs before those after it.
+static inline void dmb(void)
+{
+    uint val = 0;
 
+    asm volatile("MCR p15, 0, %[r], c7, c10, 5": :[r]"r" (val):"memory");
+}
+
+// Atomically increment *addr and return its old value, using the
+// exclusive load/store pair: the store fails (and we retry) if another
+// CPU wrote *addr in between.
+static inline uint fetch_and_inc(volatile uint *addr)
+{
+    uint old, new, fail;
+
+    asm volatile(
+        "1: LDREX   %[old], [%[addr]]\n"
+        "   ADD     %[new], %[old], #1\n"
+        "   STREX   %[fail], %[new], [%[addr]]\n"
+        "   TEQ     %[fail], #0\n"
+        "   BNE     1b\n"
+        : [old]"=&r" (old), [new]"=&r" (new), [fail]"=&r" (fail)
+        : [addr]"r" (addr)
+        : "cc", "memory");
+
+    return old;
+}
 
 // Acquire the lock.
 // Loops (spins) until the lock is acquired.
@@ -26,49 +52,47 @@ void initlock(struct spinlock *lk, char *name)
 // other CPUs to waste time spinning to acquire it.
 void acquire(struct spinlock *lk)
 {
+    uint ticket;
+
     pushcli();		// disable interrupts to avoid deadlock.
-    lk->locked = 1;	// set the lock status to make the kernel happy
 
-#if 0
+#ifdef LOCKDEBUG
+    // a CPU acquiring a lock it holds would wait for itself forever
     if(holding(lk))
         panic("acquire");
+#endif
 
-    // The xchg is atomic.
-    // It also serializes, so that reads after acquire are not
-    // reordered before it.
-    while(xchg(&lk->locked, 1) != 0)
+    ticket = fetch_and_inc(&lk->next);
+
+    while(lk->serving != ticket)
         ;
 
+    // reads and writes in the critical section must not be performed
+    // before we own the lock.
+    dmb();
+
     // Record info about lock acquisition for debugging.
-    lk->cpu = cpu;
+    lk->cpu = mycpu();
     getcallerpcs(get_fp(), lk->pcs);
-
-#endif
 }
 
 // Release the lock.
 void release(struct spinlock *lk)
 {
-#if 0
+#ifdef LOCKDEBUG
     if(!holding(lk))
         panic("release");
+#endif
 
     lk->pcs[0] = 0;
     lk->cpu = 0;
 
-    // The xchg serializes, so that reads before release are
-    // not reordered after it.  The 1996 PentiumPro manual (Volume 3,
-    // 7.2) says reads can be carried out speculatively and in
-    // any order, which implies we need to serialize here.
-    // But the 2007 Intel 64 Architecture Memory Ordering White
-    // Paper says that Intel 64 and IA-32 will not move a load
-    // after a store. So lock->locked = 0 would work here.
-    // The xchg being asm volatile ensures gcc emits it after
-    // the above assignments (and after the critical section).
-    xchg(&lk->locked, 0);
-#endif
+    // everything done in the critical section must be visible before
+    // the next ticket is served. Only the holder writes lk->serving,
+    // so a plain increment is enough.
+    dmb();
+    lk->serving++;
 
-    lk->locked = 0; // set the lock state to keep the kernel happy
     popcli();
 }
 
@@ -76,6 +100,6 @@ void release(struct spinlock *lk)
 // Check whether this cpu is holding the lock.
 int holding(struct spinlock *lock)
 {
-    return lock->locked; // && lock->cpu == cpus;
+    return (lock->serving != lock->next) && (lock->cpu == mycpu());
 }
 
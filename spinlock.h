@@ -1,11 +1,13 @@
-// Mutual exclusion lock.
+// Mutual exclusion lock. A ticket lock: acquire() takes the next ticket
+// and waits until it is served, so CPUs get the lock in FIFO order.
 struct spinlock {
-    uint        locked;     // Is the lock held?
+    volatile uint   next;       // next ticket to hand out
+    volatile uint   serving;    // ticket of the holder (held if != next)
 
     // For debugging:
     char        *name;      // Name of lock.
     struct cpu  *cpu;       // The cpu holding the lock.
-    uint        pcs[10];    // The call stack (an array of program counters)
+    uint        pcs[N_CALLSTK]; // The call stack (an array of program counters)
     // that locked the lock.
 };
 
@@ -131,6 +131,13 @@ void load_pgtlb (uint32* kern_pgtbl, uint32* user_pgtbl)
     val = 32 - UADDR_BITS;
     asm("MCR p15, 0, %[v], c2, c0, 2": :[v]"r" (val):);
 
+#if NCORE > 1
+    // take part in the coherency maintained by the snoop control unit
+    asm("MRC p15, 0, %[r], c1, c0, 1": [r]"=r" (val)::);
+    val |= 0x20;
+    asm("MCR p15, 0, %[r], c1, c0, 1": :[r]"r" (val):);
+#endif
+
     // set the kernel page table
     val = (uint)kernel_pgtbl | 0x00;
     asm("MCR p15, 0, %[v], c2, c0, 1": :[v]"r" (val):);
@@ -152,6 +159,7 @@ void load_pgtlb (uint32* kern_pgtbl, uint32* user_pgtbl)
 extern void * edata_entry;
 extern void * svc_stktop;
 extern void kmain (void);
+extern void mpenter (void);
 extern void jump_stack (void);
 
 extern void * edata;
@@ -191,3 +199,13 @@ void start (void)
     
     kmain ();
 }
+
+// a secondary core: the boot core has set up everything already, just
+// enable paging and move over to the kernel
+void start_mp (void)
+{
+    load_pgtlb (kernel_pgtbl, user_pgtbl);
+    jump_stack ();
+
+    mpenter ();
+}
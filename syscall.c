@@ -14,7 +14,7 @@
 // Fetch the int at addr from the current process.
 int fetchint(uint addr, int *ip)
 {
-    if (addr >= proc->sz || addr + 4 > proc->sz)
+    if (addr >= myproc()->sz || addr + 4 > myproc()->sz)
     {
         return -1;
     }
@@ -30,13 +30,13 @@ int fetchstr(uint addr, char **pp)
 {
     char *s, *ep;
 
-    if (addr >= proc->sz)
+    if (addr >= myproc()->sz)
     {
         return -1;
     }
 
     *pp = (char *)addr;
-    ep = (char *)proc->sz;
+    ep = (char *)myproc()->sz;
 
     for (s = *pp; s < ep; s++)
     {
@@ -59,7 +59,7 @@ int argint(int n, int *ip)
         panic("too many system call parameters\n");
     }
 
-    *ip = *(&proc->tf->r1 + n);
+    *ip = *(&myproc()->tf->r1 + n);
 
     return 0;
 }
@@ -76,7 +76,7 @@ int argptr(int n, char **pp, int size)
         return -1;
     }
 
-    if ((uint)i >= proc->sz || (uint)i + size > proc->sz)
+    if ((uint)i >= myproc()->sz || (uint)i + size > myproc()->sz)
     {
         return -1;
     }
@@ -141,6 +141,16 @@ extern int sys_sleepChan(void);
 extern int sys_getChannel(void);
 extern int sys_sigChan(void);
 extern int sys_sigOneChan(void);
+extern int sys_setsched(void);
+extern int sys_setrt(void);
+extern int sys_creategroup(void);
+extern int sys_fundgroup(void);
+extern int sys_setgroup(void);
+extern int sys_sleepChanLend(void);
+extern int sys_setgang(void);
+extern int sys_sched_yield(void);
+extern int sys_yield_to(void);
+extern int sys_setquota(void);
 
 static int (*syscalls[])(void) = {
     [SYS_fork] sys_fork,
@@ -185,6 +195,16 @@ static int (*syscalls[])(void) = {
 	[SYS_sigChan]               sys_sigChan,
 	[SYS_sigOneChan]            sys_sigOneChan,
 /////////// End of final parts of threads lab/////////
+	[SYS_setsched]              sys_setsched,
+	[SYS_setrt]                 sys_setrt,
+	[SYS_creategroup]           sys_creategroup,
+	[SYS_fundgroup]             sys_fundgroup,
+	[SYS_setgroup]              sys_setgroup,
+	[SYS_sleepChanLend]         sys_sleepChanLend,
+	[SYS_setgang]               sys_setgang,
+	[SYS_sched_yield]           sys_sched_yield,
+	[SYS_yield_to]              sys_yield_to,
+	[SYS_setquota]              sys_setquota,
 };
 
 
@@ -193,13 +213,13 @@ void syscall(void)
     int num;
     int ret;
 
-    num = proc->tf->r0;
+    num = myproc()->tf->r0;
 
     // cprintf ("syscall(%d) from %s(%d)\n", num, proc->name, proc->pid);
 
     if ((num > 0) && (num <= NELEM(syscalls)) && syscalls[num])
     {
-        proc->syscall_count++; // Increment counter
+        myproc()->syscall_count++; // Increment counter
         ret = syscalls[num]();
 
         // in ARM, parameters to main (argc, argv) are passed in r0 and r1
@@ -207,12 +227,12 @@ void syscall(void)
         // anyway does not expect us to return anything).
         if (num != SYS_exec)
         {
-            proc->tf->r0 = ret;
+            myproc()->tf->r0 = ret;
         }
     }
     else
     {
-        cprintf("%d %s: unknown sys call %d\n", proc->pid, proc->name, num);
-        proc->tf->r0 = -1;
+        cprintf("%d %s: unknown sys call %d\n", myproc()->pid, myproc()->name, num);
+        myproc()->tf->r0 = -1;
     }
 }
@@ -39,4 +39,14 @@
 #define SYS_sleepChan           35
 #define SYS_getChannel          36
 #define SYS_sigChan             37
-#define SYS_sigOneChan          38
\ No newline at end of file
+#define SYS_sigOneChan          38
+#define SYS_setsched            39
+#define SYS_setrt               40
+#define SYS_creategroup         41
+#define SYS_fundgroup           42
+#define SYS_setgroup            43
+#define SYS_sleepChanLend       44
+#define SYS_setgang             45
+#define SYS_sched_yield         46
+#define SYS_yield_to            47
+#define SYS_setquota            48
\ No newline at end of file
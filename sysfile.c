@@ -25,7 +25,7 @@ static int argfd(int n, int *pfd, struct file **pf)
         return -1;
     }
 
-    if(fd < 0 || fd >= NOFILE || (f=proc->ofile[fd]) == 0) {
+    if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0) {
         return -1;
     }
 
@@ -47,8 +47,8 @@ static int fdalloc(struct file *f)
     int fd;
 
     for(fd = 0; fd < NOFILE; fd++){
-        if(proc->ofile[fd] == 0){
-            proc->ofile[fd] = f;
+        if(myproc()->ofile[fd] == 0){
+            myproc()->ofile[fd] = f;
             return fd;
         }
     }
@@ -109,7 +109,7 @@ int sys_close(void)
         return -1;
     }
 
-    proc->ofile[fd] = 0;
+    myproc()->ofile[fd] = 0;
     fileclose(f);
 
     return 0;
@@ -433,8 +433,8 @@ int sys_chdir(void)
 
     iunlock(ip);
 
-    iput(proc->cwd);
-    proc->cwd = ip;
+    iput(myproc()->cwd);
+    myproc()->cwd = ip;
 
     return 0;
 }
@@ -491,7 +491,7 @@ int sys_pipe(void)
 
     if((fd0 = fdalloc(rf)) < 0 || (fd1 = fdalloc(wf)) < 0){
         if(fd0 >= 0) {
-            proc->ofile[fd0] = 0;
+            myproc()->ofile[fd0] = 0;
         }
 
         fileclose(rf);
@@ -25,7 +25,6 @@ extern void kpt(void);
 static int nextchan = 3; // start from a small number > 0 (avoid 0 which sometimes used)
 extern struct {
     struct spinlock lock;
-    struct proc proc[NPROC];
 } ptable;
 
 extern int settickets(int pid, int n);
@@ -60,7 +59,7 @@ int sys_kill(void)
 
 int sys_getpid(void)
 {
-    return proc->pid;
+    return myproc()->pid;
 }
 
 int sys_sbrk(void)
@@ -73,7 +72,7 @@ int sys_sbrk(void)
         return -1;
     }
 
-    addr = proc->sz;
+    addr = myproc()->sz;
 
     if (growproc(n) < 0)
     {
@@ -85,30 +84,12 @@ int sys_sbrk(void)
 
 int sys_sleep(void) {
     int n;
-    uint ticks0;
 
     if(argint(0, &n) < 0)
         return -1;
 
-    acquire(&tickslock);
-    ticks0 = ticks;
-
-    // Set your custom tracking fields
-    acquire(&ptable.lock);
-    proc->sleepticks = n;
-    proc->sleeptarget = ticks0 + n;
-    release(&ptable.lock);
-
-    while(ticks - ticks0 < n){
-        if(proc->killed){
-            release(&tickslock);
-            return -1;
-        }
-        sleep(&ticks, &tickslock);
-    }
-    release(&tickslock);
-
-    return 0;
+    // parked on the timer heap, see sleepfor() in proc.c
+    return sleepfor(n);
 }
 
 // return how many clock tick interrupts have occurred
@@ -153,23 +134,115 @@ int sys_srand(void)
     return 0;
 }
 
-int sys_getpinfo(void)
+// setsched(pid, policy): pid 0 switches the system-wide class
+int sys_setsched(void)
 {
-    struct pstat kps;
-    uint uva; // user virtual address (32-bit)
+    int pid, policy;
+
+    if (argint(0, &pid) < 0 || argint(1, &policy) < 0)
+        return -1;
+
+    return setsched(pid, policy);
+}
+
+// setrt(runtime, period, deadline): all in ticks, runtime 0 to leave
+// the real-time class
+int sys_setrt(void)
+{
+    int runtime, period, deadline;
+
+    if (argint(0, &runtime) < 0 || argint(1, &period) < 0 ||
+        argint(2, &deadline) < 0)
+        return -1;
 
-    if (argint(0, (int *)&uva) < 0)
+    return setrt(runtime, period, deadline);
+}
+
+// creategroup(funding): returns the id of the new group
+int sys_creategroup(void)
+{
+    int funding;
+
+    if (argint(0, &funding) < 0)
         return -1;
 
-    if (getpinfo(&kps) < 0)
+    return creategroup(funding);
+}
+
+int sys_fundgroup(void)
+{
+    int id, funding;
+
+    if (argint(0, &id) < 0 || argint(1, &funding) < 0)
         return -1;
 
-    if (copyout(proc->pgdir, uva, (char *)&kps, sizeof(kps)) < 0)
+    return fundgroup(id, funding);
+}
+
+// setgroup(pid, id): id 0 takes pid out of its group
+int sys_setgroup(void)
+{
+    int pid, id;
+
+    if (argint(0, &pid) < 0 || argint(1, &id) < 0)
         return -1;
 
+    return setgroup(pid, id);
+}
+
+// setgang(on): coschedule the threads of the calling process or not
+int sys_setgang(void)
+{
+    int on;
+
+    if (argint(0, &on) < 0)
+        return -1;
+
+    return setgang(on);
+}
+
+// sched_yield(): give up the CPU for one scheduling round
+int sys_sched_yield(void)
+{
+    yield();
     return 0;
 }
 
+// yield_to(tid): run thread (or process) tid now, on our quantum
+int sys_yield_to(void)
+{
+    int tid;
+
+    if (argint(0, &tid) < 0)
+        return -1;
+
+    return yield_to(tid);
+}
+
+// setquota(id, quota, period): quota 0 lifts the cap
+int sys_setquota(void)
+{
+    int id, quota, period;
+
+    if (argint(0, &id) < 0 || argint(1, &quota) < 0 || argint(2, &period) < 0)
+        return -1;
+
+    return setquota(id, quota, period);
+}
+
+// getpinfo(struct pstat *ps, int n): fill in up to n entries, one per
+// live process, and return how many were filled.
+int sys_getpinfo(void)
+{
+    uint uva; // user virtual address (32-bit)
+    int n;
+
+    if (argint(0, (int *)&uva) < 0 || argint(1, &n) < 0)
+        return -1;
+
+    return getpinfo(uva, n);
+}
+
 int sys_pgpte(void)
 {
     int va;
@@ -177,12 +250,12 @@ int sys_pgpte(void)
     if (argint(0, &va) < 0)
         return -1;
 
-    return pgpte_kernel(proc, (void *)(uint)va);
+    return pgpte_kernel(myproc(), (void *)(uint)va);
 }
 
 int sys_ugetpid(void)
 {
-    return proc->pid;
+    return myproc()->pid;
 }
 
 int sys_kpt(void)
@@ -293,7 +366,12 @@ int sys_barrier_check(void)
 
 int sys_waitpid(void)
 {
-  return -1;
+    int pid;
+
+    if (argint(0, &pid) < 0)
+        return -1;
+
+    return waitpid(pid);
 }
 
 int sys_sleepChan(void) {
@@ -305,6 +383,17 @@ int sys_sleepChan(void) {
     return 0;
 }
 
+// sleepChanLend(ch, pid): sleepChan, lending our tickets to pid until
+// woken up
+int sys_sleepChanLend(void) {
+    int ch, pid;
+    if(argint(0,&ch)<0 || argint(1,&pid)<0) return -1;
+    acquire(&ptable.lock);
+    sleeplend((void*)(uint)ch,&ptable.lock,pid);
+    release(&ptable.lock);
+    return 0;
+}
+
 int sys_getChannel(void) {
     int ch;
     acquire(&ptable.lock);
@@ -316,9 +405,7 @@ int sys_getChannel(void) {
 int sys_sigChan(void) {
     int ch;
     if(argint(0,&ch)<0) return -1;
-    acquire(&ptable.lock);
-    wakeup((void*)(uint)ch);
-    release(&ptable.lock);
+    wakeup((void*)(uint)ch);    // takes ptable.lock itself
     return 0;
 }
 
@@ -326,15 +413,7 @@ int sys_sigOneChan(void) {
     int ch;
     if(argint(0,&ch)<0) return -1;
     acquire(&ptable.lock);
-
-    struct proc *p;
-    for(p=ptable.proc; p<&ptable.proc[NPROC];p++){
-        if(p->state==SLEEPING && p->chan ==(void*)(uint)ch){
-            p->state=RUNNABLE;
-            p->chan=0;
-            break;
-        }
-    }
+    wakeupone((void*)(uint)ch);
     release(&ptable.lock);
     return 0;
 }
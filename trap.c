@@ -9,20 +9,40 @@
 // trap routine
 void swi_handler (struct trapframe *r)
 {
-    proc->tf = r;
+    myproc()->tf = r;
     syscall ();
+
+    // a killed process exits on its way back to user space
+    if (myproc()->killed) {
+        exit();
+    }
 }
 
 // trap routine
 void irq_handler (struct trapframe *r)
 {
-    // proc points to the current process. If the kernel is
-    // running scheduler, proc is NULL.
-    if (proc != NULL) {
-        proc->tf = r;
+    // myproc() is the current process. If the kernel is
+    // running scheduler, it is NULL.
+    if (myproc() != NULL) {
+        myproc()->tf = r;
     }
 
     pic_dispatch (r);
+
+    // time slicing: if the interrupted process was running in user mode
+    // and has used up its quantum, or the scheduler wants the CPU for a
+    // gang, give the CPU back to the scheduler. Only preempt on the way
+    // back to user space so that we never switch away from kernel code
+    // in the middle of a critical section.
+    if ((myproc() != NULL) && (myproc()->state == RUNNING)
+            && ((r->spsr & MODE_MASK) == USR_MODE)
+            && (mycpu()->resched || (ticks - myproc()->slicestart >= QUANTUM))) {
+        yield();
+    }
+
+    if ((myproc() != NULL) && myproc()->killed && ((r->spsr & MODE_MASK) == USR_MODE)) {
+        exit();
+    }
 }
 
 // trap routine
@@ -66,14 +86,14 @@ void dabort_handler(struct trapframe *r)
     char *mem = alloc_page();
     if(mem == 0){
         cprintf("page allocation failed\n");
-        proc->killed = 1; // kill process if no memory
+        myproc()->killed = 1; // kill process if no memory
         return;
     }
     memset(mem, 0, PGSIZE);
-    if(mappages(proc->pgdir, va, PGSIZE, V2P(mem), PTE_TYPE | AP_KU) < 0){
+    if(mappages(myproc()->pgdir, va, PGSIZE, V2P(mem), PTE_TYPE | AP_KU) < 0){
         cprintf("mappages failed\n");
         free_page(mem);   // fix: pass 0 as order
-        proc->killed = 1;
+        myproc()->killed = 1;
         return;
     }
     cprintf("allocated new page for VA 0x%x\n",va);
@@ -112,9 +132,6 @@ void fiq_handler (struct trapframe *r)
 void trap_init ( )
 {
     volatile uint32 *ram_start;
-    char *stk;
-    int i;
-    uint modes[] = {FIQ_MODE, IRQ_MODE, ABT_MODE, UND_MODE};
 
     // the opcode of PC relative load (to PC) instruction LDR pc, [pc,...]
     static uint32 const LDR_PCPC = 0xE59FF000U;
@@ -140,7 +157,17 @@ void trap_init ( )
     ram_start[14] = (uint32)trap_irq;
     ram_start[15] = (uint32)trap_fiq;
 
-    // initialize the stacks for different mode
+    trap_stack_init ();
+}
+
+// initialize the stacks for different mode. The stack pointers are
+// banked per core, so each core calls this for itself.
+void trap_stack_init (void)
+{
+    char *stk;
+    int i;
+    uint modes[] = {FIQ_MODE, IRQ_MODE, ABT_MODE, UND_MODE};
+
     for (i = 0; i < sizeof(modes)/sizeof(uint); i++) {
         stk = alloc_page ();
 
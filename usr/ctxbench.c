@@ -0,0 +1,93 @@
+// measure the cost of switching between two threads of one process,
+// which share a page table, against switching between two processes.
+// The two sides bounce a byte through a pair of pipes, so each round
+// trip is two switches each way.
+//   usage: ctxbench [rounds]
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+int ping[2], pong[2];
+int rounds;
+
+// pass the byte back, rounds times
+void bounce(void)
+{
+  char c;
+  int i;
+
+  for(i = 0; i < rounds; i++) {
+    if(read(ping[0], &c, 1) != 1)
+      break;
+    write(pong[1], &c, 1);
+  }
+}
+
+void* partner(void *arg)
+{
+  bounce();
+  thread_exit();
+  return 0;
+}
+
+// run the round trips against a thread or a child, return the ticks
+int run(int thread)
+{
+  uint tid;
+  int i, start, elapsed;
+  char c = 'x';
+
+  if(pipe(ping) < 0 || pipe(pong) < 0) {
+    printf(2, "ctxbench: pipe failed\n");
+    exit();
+  }
+
+  start = uptime();
+  if(thread) {
+    if(thread_create(&tid, partner, 0) < 0) {
+      printf(2, "ctxbench: thread_create failed\n");
+      exit();
+    }
+  } else {
+    if(fork() == 0) {
+      bounce();
+      exit();
+    }
+  }
+
+  for(i = 0; i < rounds; i++) {
+    write(ping[1], &c, 1);
+    read(pong[0], &c, 1);
+  }
+  elapsed = uptime() - start;
+
+  if(thread)
+    thread_join(tid);
+  else
+    wait();
+
+  close(ping[0]);
+  close(ping[1]);
+  close(pong[0]);
+  close(pong[1]);
+
+  return elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+  int t, p;
+
+  rounds = argc > 1 ? atoi(argv[1]) : 5000;
+  if(rounds < 1) {
+    printf(2, "usage: ctxbench [rounds]\n");
+    exit();
+  }
+
+  t = run(1);
+  p = run(0);
+
+  printf(1, "%d round trips: threads %d ticks, processes %d ticks\n",
+         rounds, t, p);
+  exit();
+}
@@ -1,8 +1,15 @@
 #include "types.h"
 #include "stat.h"
 #include "user.h"
+#include "pstat.h"
 
-int main(void) {
+#define TICKETS  10
+#define ROUNDS   5      // reports of the CPU time used so far
+#define INTERVAL 20     // ticks between reports
+#define CHUNK    2000   // iterations the I/O-bound process works per request
+
+// a sleeper with few tickets next to a worker with many
+void sleeper(void) {
   int pid = fork();
   if(pid == 0) {
     settickets(getpid(), 1);
@@ -17,7 +24,74 @@ int main(void) {
       printf(1, "Parent working...\n");
     }
     wait();
+  }
+}
+
+// CPU time used by pid so far, in microseconds
+uint runus(int pid) {
+  struct pstat st;
+
+  return getpinfopid(pid, &st) == 0 ? st.runus : 0;
+}
+
+// an I/O-bound and a CPU-bound process with equal tickets: the I/O-bound
+// one blocks on a pipe round trip after a fraction of each quantum, yet
+// with compensation tickets their CPU times converge
+void iovscpu(void) {
+  int req[2], resp[2];
+  int echo, io, cpu, i;
+  uint iot, cput;
+  char c;
+  volatile int j;
+
+  // keep the harness ahead so it reports on time
+  settickets(getpid(), 100);
+
+  pipe(req);
+  pipe(resp);
+
+  // answers each request right away
+  if((echo = fork()) == 0) {
+    while(read(req[0], &c, 1) == 1)
+      write(resp[1], &c, 1);
     exit();
   }
+  settickets(echo, TICKETS);
+
+  if((io = fork()) == 0) {
+    for(;;) {
+      for(j = 0; j < CHUNK; j++)
+        ;
+      write(req[1], &c, 1);
+      read(resp[0], &c, 1);
+    }
+  }
+  settickets(io, TICKETS);
+
+  if((cpu = fork()) == 0) {
+    for(;;)
+      ;
+  }
+  settickets(cpu, TICKETS);
+
+  for(i = 1; i <= ROUNDS; i++) {
+    sleep(INTERVAL);
+    iot = runus(io) / 1000;
+    cput = runus(cpu) / 1000;
+    printf(1, "after %d ticks: I/O-bound %d ms, CPU-bound %d ms, ratio %d/100\n",
+           i * INTERVAL, iot, cput, cput ? iot * 100 / cput : 0);
+  }
+
+  kill(io);
+  kill(cpu);
+  kill(echo);
+  wait();
+  wait();
+  wait();
 }
 
+int main(void) {
+  sleeper();
+  iovscpu();
+  exit();
+}
@@ -0,0 +1,99 @@
+// compare gang mode with independent scheduling of threads: a few
+// threads run rounds of work separated by a spinning barrier while CPU
+// hogs compete for the cores. Without gang mode a thread that is
+// descheduled stalls the others, which spin at the barrier.
+//   usage: gangtest [nthreads [nhogs [rounds]]]
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+
+#define MAXTHREAD 8
+#define WORK      2000    // iterations of work per round
+
+struct lock lk;
+volatile int arrived;     // threads at the barrier in this round
+volatile int sense;       // flips when the last one arrives
+int nthreads, rounds;
+
+// a sense-reversing barrier: spin until all the threads arrived
+void barrier(int *local)
+{
+  *local = !*local;
+  acquireLock(&lk);
+  if(++arrived == nthreads) {
+    arrived = 0;
+    sense = *local;
+  }
+  releaseLock(&lk);
+  while(sense != *local)
+    ;
+}
+
+void *worker(void *arg)
+{
+  volatile int j;
+  int i, local;
+
+  local = 0;
+  for(i = 0; i < rounds; i++) {
+    for(j = 0; j < WORK; j++)
+      ;
+    barrier(&local);
+  }
+  thread_exit();
+  return 0;
+}
+
+// run the rounds with gang mode on or off, return the ticks they took
+int run(int gang)
+{
+  uint tid[MAXTHREAD];
+  int i, start;
+
+  setgang(gang);
+  arrived = 0;
+  sense = 0;
+  start = uptime();
+  for(i = 0; i < nthreads; i++)
+    thread_create(&tid[i], worker, 0);
+  for(i = 0; i < nthreads; i++)
+    thread_join(tid[i]);
+  return uptime() - start;
+}
+
+int main(int argc, char *argv[])
+{
+  int pid[NCPU * 4];
+  int nhogs, i, off, on;
+
+  nthreads = argc > 1 ? atoi(argv[1]) : 4;
+  nhogs = argc > 2 ? atoi(argv[2]) : 4;
+  rounds = argc > 3 ? atoi(argv[3]) : 200;
+  if(nthreads < 2 || nthreads > MAXTHREAD || nhogs < 0 || nhogs > NCPU * 4
+     || rounds < 1) {
+    printf(2, "usage: gangtest [nthreads [nhogs [rounds]]]\n");
+    exit();
+  }
+
+  initiateLock(&lk);
+  for(i = 0; i < nhogs; i++) {
+    pid[i] = fork();
+    if(pid[i] == 0) {
+      for(;;)
+        ;   // never blocks
+    }
+  }
+
+  off = run(0);
+  on = run(1);
+  printf(1, "gangtest: %d threads, %d hogs, %d rounds\n", nthreads, nhogs, rounds);
+  printf(1, "independent: %d ticks\n", off);
+  printf(1, "gang:        %d ticks\n", on);
+
+  for(i = 0; i < nhogs; i++) {
+    kill(pid[i]);
+    wait();
+  }
+  exit();
+}
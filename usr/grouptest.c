@@ -0,0 +1,113 @@
+// check that ticket groups (currencies) hold a multithreaded process,
+// or a group of processes, to the share of its funding: each scenario
+// runs a group of spinners against a single process with as many
+// tickets as the group has funding, and both should get half the CPU
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+#define NMEMBER 8     // spinners in the group
+#define TICKETS 10    // funding of the group, tickets of the single one
+#define RUNFOR  100   // ticks to measure for
+
+int end;
+
+void spin(void)
+{
+  while(uptime() < end)
+    ;
+}
+
+void *spinthread(void *arg)
+{
+  spin();
+  thread_exit();
+  return 0;
+}
+
+// the group of NMEMBER threads of this process
+void threads(void)
+{
+  uint tid[NMEMBER - 1];
+  int i;
+
+  settickets(getpid(), TICKETS);
+  for(i = 0; i < NMEMBER - 1; i++)
+    thread_create(&tid[i], spinthread, 0);
+  spin();
+  for(i = 0; i < NMEMBER - 1; i++)
+    thread_join(tid[i]);
+  exit();
+}
+
+// the group of NMEMBER processes
+void processes(void)
+{
+  int i;
+
+  creategroup(TICKETS);
+  for(i = 0; i < NMEMBER - 1; i++) {
+    if(fork() == 0) {
+      spin();
+      exit();
+    }
+  }
+  spin();
+  for(i = 0; i < NMEMBER - 1; i++)
+    wait();
+  exit();
+}
+
+// run the group against a single process, report the share of the group
+void run(char *name, void (*group)(void))
+{
+  struct pstat *ps;
+  int gpid, spid, gid, i, cnt, grun, srun, share;
+
+  end = uptime() + RUNFOR + 20;
+
+  if((gpid = fork()) == 0)
+    group();
+  if((spid = fork()) == 0) {
+    settickets(getpid(), TICKETS);
+    spin();
+    exit();
+  }
+
+  sleep(RUNFOR);
+
+  if((ps = getpinfoall(&cnt)) == 0)
+    exit();
+  gid = 0;
+  for(i = 0; i < cnt; i++) {
+    if(ps[i].pid == gpid)
+      gid = ps[i].group;
+  }
+  grun = srun = 0;
+  for(i = 0; i < cnt; i++) {
+    if(gid != 0 && ps[i].group == gid)
+      grun += ps[i].runticks;
+    if(ps[i].pid == spid)
+      srun = ps[i].runticks;
+  }
+  free(ps);
+
+  wait();
+  wait();
+
+  share = grun + srun ? grun * 1000 / (grun + srun) : 0;
+  printf(1, "%s: group %d runticks %d, single runticks %d, group share %d/1000 (expected 500/1000)\n",
+         name, gid, grun, srun, share);
+}
+
+int main(void)
+{
+  // keep the harness ahead of the spinners so it wakes on time
+  settickets(getpid(), 100);
+
+  run("threads", threads);
+  run("processes", processes);
+
+  exit();
+}
@@ -0,0 +1,82 @@
+// measure how late an interactive process (1 ticket, sleeps a tick at
+// a time) gets the CPU back while CPU hogs with 10 tickets run, under
+// the lottery and the MLFQ policies
+//   usage: latbench [nhogs [nsamples]]
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+
+#define MAXSAMPLE 200
+
+int lat[MAXSAMPLE];
+
+// sleep a tick at a time, record how many ticks late each wakeup runs
+void sample(int n)
+{
+  int i, t0;
+
+  for(i = 0; i < n; i++) {
+    t0 = uptime();
+    sleep(1);
+    lat[i] = uptime() - t0 - 1;
+  }
+}
+
+// run the workload under policy, report the mean and p99 latency
+void run(int policy, char *name, int nhogs, int n)
+{
+  int pid[NCPU * 4];
+  int i, j, t, sum;
+
+  setsched(0, policy);
+
+  for(i = 0; i < nhogs; i++) {
+    pid[i] = fork();
+    if(pid[i] == 0) {
+      for(;;)
+        ;   // never blocks
+    }
+    settickets(pid[i], 10);
+  }
+
+  sample(n);
+
+  for(i = 0; i < nhogs; i++) {
+    kill(pid[i]);
+    wait();
+  }
+
+  sum = 0;
+  for(i = 0; i < n; i++) {
+    sum += lat[i];
+    for(j = i; j > 0 && lat[j - 1] > lat[j]; j--) {
+      t = lat[j];
+      lat[j] = lat[j - 1];
+      lat[j - 1] = t;
+    }
+  }
+  printf(1, "%s: wakeup latency mean %d/100 ticks, p99 %d ticks\n",
+         name, sum * 100 / n, lat[n * 99 / 100]);
+}
+
+int main(int argc, char *argv[])
+{
+  int nhogs, n, old;
+
+  nhogs = argc > 1 ? atoi(argv[1]) : 4;
+  n = argc > 2 ? atoi(argv[2]) : 100;
+  if(nhogs < 1 || nhogs > NCPU * 4 || n < 1 || n > MAXSAMPLE) {
+    printf(2, "usage: latbench [nhogs [nsamples]]\n");
+    exit();
+  }
+
+  settickets(getpid(), 1);
+  old = setsched(0, SCHED_LOTTERY);
+
+  run(SCHED_LOTTERY, "lottery", nhogs, n);
+  run(SCHED_MLFQ, "mlfq", nhogs, n);
+
+  setsched(0, old);
+  exit();
+}
@@ -0,0 +1,95 @@
+// check ticket lending: a 1-ticket server answers requests from a
+// 20-ticket client over pipes while CPU hogs run. While the client
+// waits for an answer, the server should hold the client's tickets.
+//   usage: lendtest [nhogs [nrequests]]
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pstat.h"
+
+#define WORK 200000   // iterations of work per request
+
+// tickets pid has borrowed, -1 if it is gone
+int borrowed(int pid)
+{
+  struct pstat st;
+
+  return getpinfopid(pid, &st) == 0 ? st.borrowed : -1;
+}
+
+// answer each request with the most tickets borrowed while working on it
+void server(int in, int out)
+{
+  volatile int j;
+  int req, most, b;
+
+  while(read(in, &req, sizeof(req)) == sizeof(req)) {
+    most = 0;
+    for(j = 0; j < WORK; j++) {
+      if(j % (WORK / 4) == 0 && (b = borrowed(getpid())) > most)
+        most = b;
+    }
+    write(out, &most, sizeof(most));
+  }
+  exit();
+}
+
+int main(int argc, char *argv[])
+{
+  int req[2], resp[2], pid[NCPU * 4];
+  int nhogs, n, i, spid, most, got, start;
+
+  nhogs = argc > 1 ? atoi(argv[1]) : 4;
+  n = argc > 2 ? atoi(argv[2]) : 20;
+  if(nhogs < 0 || nhogs > NCPU * 4 || n < 2) {
+    printf(2, "usage: lendtest [nhogs [nrequests]]\n");
+    exit();
+  }
+
+  if(pipe(req) < 0 || pipe(resp) < 0) {
+    printf(2, "lendtest: pipe failed\n");
+    exit();
+  }
+
+  if((spid = fork()) == 0) {
+    close(req[1]);
+    close(resp[0]);
+    server(req[0], resp[1]);
+  }
+  close(req[0]);
+  close(resp[1]);
+  settickets(spid, 1);
+  settickets(getpid(), 20);
+
+  for(i = 0; i < nhogs; i++) {
+    pid[i] = fork();
+    if(pid[i] == 0) {
+      for(;;)
+        ;   // never blocks
+    }
+    settickets(pid[i], 5);
+  }
+
+  // the server has not written yet when the first request goes out,
+  // so only the later ones can lend to it
+  most = 0;
+  start = uptime();
+  for(i = 0; i < n; i++) {
+    write(req[1], &i, sizeof(i));
+    read(resp[0], &got, sizeof(got));
+    if(i > 0 && got > most)
+      most = got;
+  }
+  printf(1, "lendtest: %d requests in %d ticks, server borrowed up to %d tickets\n",
+         n, uptime() - start, most);
+  printf(1, "lendtest: %s\n", most >= 20 ? "OK" : "FAILED");
+
+  close(req[1]);
+  wait();
+  for(i = 0; i < nhogs; i++) {
+    kill(pid[i]);
+    wait();
+  }
+  exit();
+}
@@ -1,15 +1,19 @@
 #ifndef _PSTAT_H_
 #define _PSTAT_H_
 
-#include "param.h"
-
+// scheduling statistics of one live process, see getpinfo()
 struct pstat
 {
-  int inuse[NPROC];
-  int pid[NPROC];
-  int tickets[NPROC];
-  int runticks[NPROC];
-  int boostsleft[NPROC];
+  int pid;
+  int tickets;
+  int runticks;
+  int boostsleft;
+  int sched;      // scheduler class, SCHED_*
+  int rtmisses;   // deadlines missed in the EDF class
+  int group;      // ticket group, 0 if none
+  int borrowed;   // tickets lent to it by blocked processes
+  uint runus;     // CPU time used, in microseconds
+  uint throttled; // ticks its group spent throttled by its quota
 };
 
 #endif
@@ -0,0 +1,56 @@
+// check CPU bandwidth quotas: a CPU hog in a group capped at QUOTA of
+// every PERIOD ticks runs on an otherwise idle machine. It should get
+// no more than its quota of one CPU, and its group should be reported
+// as throttled for the rest.
+//   usage: quotatest [quota [period [ticks]]]
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pstat.h"
+
+int main(int argc, char *argv[])
+{
+  struct pstat st;
+  int quota, period, runfor, gid, pid, start, elapsed, got, want;
+
+  quota = argc > 1 ? atoi(argv[1]) : 3;
+  period = argc > 2 ? atoi(argv[2]) : 10;
+  runfor = argc > 3 ? atoi(argv[3]) : 100;
+  if(quota < 1 || period < quota || runfor < period) {
+    printf(2, "usage: quotatest [quota [period [ticks]]]\n");
+    exit();
+  }
+
+  // the hog inherits the group, then we leave it to the hog alone
+  if((gid = creategroup(10)) < 0 || setquota(gid, quota, period) < 0) {
+    printf(2, "quotatest: cannot set up the group\n");
+    exit();
+  }
+  if((pid = fork()) == 0) {
+    for(;;)
+      ;   // never blocks
+  }
+  setgroup(getpid(), 0);
+
+  start = uptime();
+  sleep(runfor);
+  elapsed = uptime() - start;
+  if(getpinfopid(pid, &st) < 0) {
+    printf(2, "quotatest: the hog is gone\n");
+    exit();
+  }
+  kill(pid);
+  wait();
+
+  // per mille of one CPU, against the quota
+  got = st.runus / elapsed * HZ / 1000;
+  want = quota * 1000 / period;
+  printf(1, "quotatest: quota %d/%d ticks, hog used %d/1000 of a CPU over %d ticks\n",
+         quota, period, got, elapsed);
+  printf(1, "quotatest: group throttled for %d ticks\n", st.throttled);
+  // the quota is charged a tick at a time, allow one tick per period
+  printf(1, "quotatest: %s\n",
+         got <= want + 1000 / period && st.throttled > 0 ? "OK" : "FAILED");
+  exit();
+}
@@ -0,0 +1,67 @@
+// check the real-time (EDF) class: admission control, and that a
+// periodic process gets its reserved share next to CPU hogs
+//   usage: rttest [nhogs]
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pstat.h"
+
+#define RUNTIME 2     // ticks reserved per period
+#define PERIOD  10
+#define RUNFOR  100   // ticks to spin for
+
+int main(int argc, char *argv[])
+{
+  struct pstat st0, st;
+  int pid[NCPU * 4];
+  int nhogs, i, end, got, want;
+
+  nhogs = argc > 1 ? atoi(argv[1]) : 4;
+  if(nhogs < 0 || nhogs > NCPU * 4) {
+    printf(2, "usage: rttest [nhogs]\n");
+    exit();
+  }
+
+  // admission control
+  if(setrt(RUNTIME + 1, RUNTIME, RUNTIME) == 0)
+    printf(1, "rttest: runtime > deadline admitted: FAILED\n");
+  if(setrt(PERIOD, PERIOD, PERIOD) == 0)
+    printf(1, "rttest: a whole CPU admitted: FAILED\n");
+  if(setrt(RUNTIME, PERIOD, PERIOD) < 0) {
+    printf(1, "rttest: %d/%d rejected: FAILED\n", RUNTIME, PERIOD);
+    exit();
+  }
+  setrt(0, 0, 0);
+
+  for(i = 0; i < nhogs; i++) {
+    pid[i] = fork();
+    if(pid[i] == 0) {
+      for(;;)
+        ;   // never blocks
+    }
+    settickets(pid[i], 10);
+  }
+
+  setrt(RUNTIME, PERIOD, PERIOD);
+  getpinfopid(getpid(), &st0);
+  end = uptime() + RUNFOR;
+  while(uptime() < end)
+    ;
+  getpinfopid(getpid(), &st);
+  setrt(0, 0, 0);
+
+  for(i = 0; i < nhogs; i++) {
+    kill(pid[i]);
+    wait();
+  }
+
+  got = st.runticks - st0.runticks;
+  want = RUNFOR * RUNTIME / PERIOD;
+  printf(1, "rttest: class %d, ran %d of %d ticks (reserved %d), %d deadline misses\n",
+         st.sched, got, RUNFOR, want, st.rtmisses);
+  printf(1, "rttest: %s\n",
+         st.sched == SCHED_EDF && got >= want - 1 && st.rtmisses == 0 ? "OK" : "FAILED");
+
+  exit();
+}
@@ -0,0 +1,83 @@
+// compare how closely the lottery and stride policies track the
+// ticket ratios for the same CPU-bound workload
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pstat.h"
+
+#define NWORKER 3
+#define RUNFOR  100   // ticks each policy runs the workload
+
+int tickets[NWORKER] = {1, 2, 3};
+
+// run the workload under policy, return the share error in per mille
+int run(int policy, char *name)
+{
+  struct pstat st;
+  int pid[NWORKER], runs[NWORKER];
+  int i, total, err, got, want, tsum;
+
+  setsched(0, policy);
+
+  for(i = 0; i < NWORKER; i++) {
+    pid[i] = fork();
+    if(pid[i] == 0) {
+      for(;;)
+        ;   // never blocks
+    }
+    settickets(pid[i], tickets[i]);
+  }
+
+  sleep(RUNFOR);
+
+  total = 0;
+  for(i = 0; i < NWORKER; i++) {
+    runs[i] = 0;
+    if(getpinfopid(pid[i], &st) == 0) {
+      runs[i] = st.runticks;
+      if(st.sched != policy)
+        printf(1, "%s: pid %d is in class %d\n", name, pid[i], st.sched);
+    }
+    total += runs[i];
+  }
+
+  for(i = 0; i < NWORKER; i++) {
+    kill(pid[i]);
+    wait();
+  }
+
+  tsum = 0;
+  for(i = 0; i < NWORKER; i++)
+    tsum += tickets[i];
+
+  err = 0;
+  printf(1, "%s:\n", name);
+  for(i = 0; i < NWORKER; i++) {
+    got = total ? runs[i] * 1000 / total : 0;
+    want = tickets[i] * 1000 / tsum;
+    printf(1, "  tickets %d: runticks %d share %d/1000 (expected %d/1000)\n",
+           tickets[i], runs[i], got, want);
+    err += got > want ? got - want : want - got;
+  }
+  printf(1, "  share error: %d/1000\n", err);
+
+  return err;
+}
+
+int main(int argc, char *argv[])
+{
+  int lottery, stride, old;
+
+  // keep the harness itself ahead of the workers so it wakes on time
+  settickets(getpid(), 100);
+  old = setsched(0, SCHED_LOTTERY);
+
+  lottery = run(SCHED_LOTTERY, "lottery");
+  stride = run(SCHED_STRIDE, "stride");
+
+  printf(1, "share error lottery %d/1000, stride %d/1000\n", lottery, stride);
+
+  setsched(0, old);
+  exit();
+}
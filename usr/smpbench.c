@@ -0,0 +1,102 @@
+// run CPU-bound workers with different tickets on all the cores, and
+// report the throughput and how closely the work done follows the
+// ticket ratios
+//   usage: smpbench [nworkers [ticks]]
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define MAXWORKER 32
+#define CHUNK     10000   // iterations counted as one unit of work
+
+int tickets(int i)
+{
+  return i % 4 + 1;
+}
+
+// spin until the deadline, then report the units of work done
+void worker(int i, int end, int fd)
+{
+  int rec[2];
+  volatile int j;
+
+  rec[0] = i;
+  rec[1] = 0;
+  while(uptime() < end) {
+    for(j = 0; j < CHUNK; j++)
+      ;
+    rec[1]++;
+  }
+  write(fd, rec, sizeof(rec));
+  exit();
+}
+
+int main(int argc, char *argv[])
+{
+  int n, runfor, start, end, elapsed;
+  int fd[2], rec[2], pid;
+  int work[MAXWORKER];
+  int i, total, tsum, got, want, err;
+
+  n = argc > 1 ? atoi(argv[1]) : 8;
+  runfor = argc > 2 ? atoi(argv[2]) : 100;
+  if(n < 1 || n > MAXWORKER || runfor < 1) {
+    printf(2, "usage: smpbench [nworkers [ticks]]\n");
+    exit();
+  }
+
+  if(pipe(fd) < 0) {
+    printf(2, "smpbench: pipe failed\n");
+    exit();
+  }
+
+  // keep the harness ahead of the workers so it starts them all on time
+  settickets(getpid(), 100);
+
+  start = uptime();
+  end = start + runfor;
+  for(i = 0; i < n; i++) {
+    pid = fork();
+    if(pid < 0) {
+      printf(2, "smpbench: fork failed\n");
+      exit();
+    }
+    if(pid == 0) {
+      close(fd[0]);
+      settickets(getpid(), tickets(i));
+      worker(i, end, fd[1]);
+    }
+  }
+  close(fd[1]);
+
+  for(i = 0; i < n; i++)
+    work[i] = 0;
+  while(read(fd[0], rec, sizeof(rec)) == sizeof(rec)) {
+    if(rec[0] >= 0 && rec[0] < n)
+      work[rec[0]] = rec[1];
+  }
+  for(i = 0; i < n; i++)
+    wait();
+  elapsed = uptime() - start;
+
+  total = 0;
+  tsum = 0;
+  for(i = 0; i < n; i++) {
+    total += work[i];
+    tsum += tickets(i);
+  }
+
+  err = 0;
+  for(i = 0; i < n; i++) {
+    got = total ? work[i] * 1000 / total : 0;
+    want = tickets(i) * 1000 / tsum;
+    printf(1, "worker %d: tickets %d work %d share %d/1000 (expected %d/1000)\n",
+           i, tickets(i), work[i], got, want);
+    err += got > want ? got - want : want - got;
+  }
+  printf(1, "throughput: %d units/tick over %d ticks\n",
+         elapsed ? total / elapsed : total, elapsed);
+  printf(1, "share error: %d/1000\n", err);
+
+  exit();
+}
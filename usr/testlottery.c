@@ -1,20 +1,32 @@
 #include "types.h"
 #include "stat.h"
 #include "user.h"
+#include "pstat.h"
 //#include "proc.h"
 
+#define NLOOPS 20000000
+
+// print how many times pid has been scheduled so far
+void report(char *who, int pid) {
+  struct pstat st;
+
+  if(getpinfopid(pid, &st) == 0)
+    printf(1, "%s: tickets=%d runticks=%d\n", who, st.tickets, st.runticks);
+}
+
 int main(void) {
   int pid = fork();
   if(pid == 0) {
     settickets(getpid(), 10);  // child gets 10 tickets
-    for(int i=0; i<1000000; i++) ; // busy loop
+    for(int i=0; i<NLOOPS; i++) ; // busy loop, never blocks
     printf(1, "Child finished\n");
+    report("child", getpid());
   } else {
     settickets(getpid(), 1);   // parent gets 1 ticket
-    for(int i=0; i<1000000; i++) ;
+    for(int i=0; i<NLOOPS; i++) ;
     printf(1, "Parent finished\n");
+    report("parent", getpid());
     wait();
   }
   exit();
 }
-
@@ -2,6 +2,7 @@
 #include "stat.h"
 #include "fcntl.h"
 #include "user.h"
+#include "pstat.h"
 
 char*
 strcpy(char *s, char *t)
@@ -148,17 +149,25 @@ void initiateLock(struct lock* l) {
     if(!l) return;
     l->lockvar=0;
     l->isInitiated=1;
+    l->owner=0;
 }
 
 void acquireLock(struct lock* l) {
+    int owner;
     if(!l || !l->isInitiated) return;
     while(xchg(&l->lockvar,1)!=0){
-        //spin
+        //let a holder that is not running finish instead of spinning;
+        //one running on another CPU will be done soon, keep spinning
+        owner=l->owner;
+        if(owner!=0)
+            yield_to(owner);
     }
+    l->owner=getpid();
 }
 
 void releaseLock(struct lock* l) {
     if(!l || !l->isInitiated) return;
+    l->owner=0;
     //memory barrier if needed
     xchg(&l->lockvar,0);
 }
@@ -168,6 +177,7 @@ void initiateCondVar(struct condvar* cv) {
     int ch=getChannel();
     if(ch<0) { cv->isInitiated=0; return;}
     cv->var=ch;
+    cv->signaler=0;
     cv->isInitiated=1;
 }
 
@@ -176,17 +186,19 @@ void condWait(struct condvar* cv, struct lock* l) {
     if(!l || !l->isInitiated) return;
 
     releaseLock(l);
-    sleepChan(cv->var);
+    sleepChanLend(cv->var, cv->signaler); // most likely the one to signal us
     acquireLock(l);
 }
 
 void broadcast(struct condvar* cv) {
     if(!cv || !cv->isInitiated) return;
+    cv->signaler=getpid();
     sigChan(cv->var);
 }
 
 void signal(struct condvar* cv) {
     if(!cv || !cv->isInitiated) return;
+    cv->signaler=getpid();
     sigOneChan(cv->var);
 }
 
@@ -221,6 +233,41 @@ void semDown(struct semaphore* s) {
     releaseLock(&s->l); //release lock after decrement 
 }
 
+// A snapshot of the scheduling statistics of all the live processes,
+// in a buffer from malloc() that the caller frees; *n is set to the
+// number of entries. Returns 0 if out of memory.
+struct pstat* getpinfoall(int *n) {
+    struct pstat *ps;
+    int size;
+
+    // the table grows on demand, so grow the buffer until it all fits
+    for(size = 16; ; size *= 2) {
+        if((ps = malloc(size * sizeof(*ps))) == 0)
+            return 0;
+        if((*n = getpinfo(ps, size)) < size)
+            return ps;
+        free(ps);
+    }
+}
+
+// Fill in *st with the statistics of pid. Returns -1 if it is gone.
+int getpinfopid(int pid, struct pstat *st) {
+    struct pstat *ps;
+    int i, n, r;
+
+    if((ps = getpinfoall(&n)) == 0)
+        return -1;
+    r = -1;
+    for(i = 0; i < n; i++) {
+        if(ps[i].pid == pid) {
+            *st = ps[i];
+            r = 0;
+        }
+    }
+    free(ps);
+    return r;
+}
+
 
 
 // int getChannel(void) {
@@ -26,7 +26,9 @@ int ps(void); // calling ps() so that compilar know there exist ps command
 int settickets(int pid, int n_tickets);
 void srand(uint seed);
 struct pstat;
-int getpinfo(struct pstat *ps);
+int getpinfo(struct pstat *ps, int n);
+struct pstat *getpinfoall(int *n);
+int getpinfopid(int pid, struct pstat *st);
 
 typedef uint pte_t;
 uint pgpte(void *va);
@@ -48,17 +50,30 @@ int sleepChan(int);
 int getChannel(void);
 int sigChan(int);
 int sigOneChan(int);
+int setsched(int pid, int policy);
+int setrt(int runtime, int period, int deadline);
+int creategroup(int funding);
+int fundgroup(int gid, int funding);
+int setgroup(int pid, int gid);
+int sleepChanLend(int ch, int pid);
+int setgang(int on);
+int sched_yield(void);
+int yield_to(int tid);
+int setquota(int gid, int quota, int period);
 
 int xchg(volatile int *addr, int newval);
 
 struct lock{
     volatile int lockvar;
     int isInitiated;
+    volatile int owner; // pid of the holder, 0 if free
 };
 
 struct condvar{
     int var;
     int isInitiated;
+    int signaler;   // pid of the last process to signal, whom waiters
+                    //   lend their tickets to
 };  
 
 struct semaphore{
@@ -0,0 +1,93 @@
+// check directed yield: threads take turns holding a lock over a long
+// critical section while CPU hogs run. A waiter hands its slice to the
+// holder with yield_to instead of spinning it away, so the updates all
+// land and the run takes about as long as the critical sections.
+//   usage: yieldtest [nthreads [nhogs [iterations]]]
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+
+#define MAXTHREAD 8
+#define WORK      20000   // iterations of work inside the lock
+
+struct lock lk;
+int counter, iters;
+
+void *worker(void *arg)
+{
+  volatile int j;
+  int i;
+
+  for(i = 0; i < iters; i++) {
+    acquireLock(&lk);
+    for(j = 0; j < WORK; j++)
+      ;
+    counter++;
+    releaseLock(&lk);
+  }
+  thread_exit();
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  uint tid[MAXTHREAD];
+  int pid[NCPU * 4];
+  int nthreads, nhogs, i, start, child, ok;
+
+  nthreads = argc > 1 ? atoi(argv[1]) : 4;
+  nhogs = argc > 2 ? atoi(argv[2]) : 2;
+  iters = argc > 3 ? atoi(argv[3]) : 50;
+  if(nthreads < 1 || nthreads > MAXTHREAD || nhogs < 0 || nhogs > NCPU * 4
+     || iters < 1) {
+    printf(2, "usage: yieldtest [nthreads [nhogs [iterations]]]\n");
+    exit();
+  }
+
+  ok = 1;
+
+  // a process that is not RUNNABLE cannot take the CPU
+  if((child = fork()) == 0) {
+    sleep(100);
+    exit();
+  }
+  sleep(1);
+  if(yield_to(child) != -1 || yield_to(getpid()) != -1) {
+    printf(1, "yieldtest: yield_to a process that cannot run succeeded\n");
+    ok = 0;
+  }
+  if(sched_yield() != 0) {
+    printf(1, "yieldtest: sched_yield failed\n");
+    ok = 0;
+  }
+  kill(child);
+  wait();
+
+  for(i = 0; i < nhogs; i++) {
+    pid[i] = fork();
+    if(pid[i] == 0) {
+      for(;;)
+        ;   // never blocks
+    }
+  }
+
+  initiateLock(&lk);
+  counter = 0;
+  start = uptime();
+  for(i = 0; i < nthreads; i++)
+    thread_create(&tid[i], worker, 0);
+  for(i = 0; i < nthreads; i++)
+    thread_join(tid[i]);
+  printf(1, "yieldtest: %d threads x %d sections in %d ticks, counter %d\n",
+         nthreads, iters, uptime() - start, counter);
+  if(counter != nthreads * iters)
+    ok = 0;
+
+  for(i = 0; i < nhogs; i++) {
+    kill(pid[i]);
+    wait();
+  }
+  printf(1, "yieldtest: %s\n", ok ? "OK" : "FAILED");
+  exit();
+}
@@ -24,6 +24,8 @@ pde_t *kpgdir;      // for use in scheduler()
 // vm.c  — paste this near other helper functions
 // Forward declaration so handle_page_fault can call it before the definition below
 static pte_t* walkpgdir(pde_t *pgdir, const void *va, int alloc);
+static void cache_clean(char *va, uint len);
+static void icache_sync(void);
 
 int
 handle_page_fault(struct proc *p, uint fault_addr)
@@ -62,8 +64,9 @@ handle_page_fault(struct proc *p, uint fault_addr)
         return -1;
     }
 
-    // zero the page
+    // zero the page, and make that what instruction fetches see
     memset(mem, 0, PTE_SZ);
+    cache_clean(mem, PTE_SZ);
 
     // map the page. Use PTE_TYPE | AP_KU that your mmu.h expects
     // Note: mappages signature in this repo: mappages(pgdir, va, size, pa, ap)
@@ -74,8 +77,9 @@ handle_page_fault(struct proc *p, uint fault_addr)
         return -1;
     }
 
-    // ensure the new mapping is visible (switchuvm reloads TTBR0 and flushes TLB)
-    switchuvm(p);
+    // the page was unmapped, so no TLB holds an entry for it (see
+    // flushupage); only the I-cache may hold what it held before
+    icache_sync();
 
     return 0;
 }
@@ -91,10 +95,90 @@ struct
     struct run *freelist;
 } kpt_mem;
 
+// ASIDs: the TLB entries of user pages (non-global, see mappages) are
+// tagged with the ASID in CONTEXTIDR, so switching address spaces needs
+// no TLB flush. ASIDs are handed out in sequence, the bits above them
+// count the generation. When they run out a new generation starts, and
+// each CPU flushes its TLB once before it uses an ASID of the new one.
+// A CPU may still run an address space under an ASID of an older
+// generation until it next switches, so a drop by ASID only works on
+// a CPU whose generation is that of the ASID; the others flush their
+// whole TLB instead (see tlb_dropasid).
+// ASID 0 is never handed out, so p->asid == 0 means "none".
+#define ASID_BITS   8
+#define ASID_MASK   ((1 << ASID_BITS) - 1)
+
+static struct
+{
+    struct spinlock lock;
+    uint next;      // generation | the next ASID to hand out
+} asid;
+
+// User code the kernel writes (exec, fork, the page fault loader) goes
+// through the D-cache, but instruction fetches only look in memory and
+// the I-cache. The writer cleans what it wrote to memory and bumps the
+// code generation; each CPU invalidates its I-cache before it runs user
+// code of a newer generation than it has seen (see icache_sync).
+#define CACHE_LINE  32  // bytes in a cache line of the ARM11
+
+static struct
+{
+    struct spinlock lock;
+    volatile uint gen;
+} code;
+
 void init_vmm(void)
 {
     initlock(&kpt_mem.lock, "vm");
     kpt_mem.freelist = NULL;
+
+    initlock(&asid.lock, "asid");
+    asid.next = (1 << ASID_BITS) | 1;   // generation 1
+
+    initlock(&code.lock, "code");
+    code.gen = 1;       // the I-caches hold nothing of user space yet
+}
+
+// Clean [va, va + len) out of the D-cache of this CPU to memory, after
+// the kernel wrote user code there through its own mapping va.
+static void cache_clean(char *va, uint len)
+{
+    uint a, end;
+
+    end = (uint)va + len;
+
+    for (a = align_dn(va, CACHE_LINE); a < end; a += CACHE_LINE)
+    {
+        asm volatile("MCR p15, 0, %[r], c7, c10, 1" : : [r] "r"(a) : "memory");
+    }
+
+    asm volatile("MCR p15, 0, %[r], c7, c10, 4" : : [r] "r"(0) : "memory");
+
+    acquire(&code.lock);
+    code.gen++;
+    release(&code.lock);
+}
+
+// Invalidate the I-cache and the branch predictor of this CPU if user
+// code was written since it last did.
+static void icache_sync(void)
+{
+    uint gen, val;
+
+    gen = code.gen;
+
+    if (mycpu()->icachegen == gen)
+    {
+        return;
+    }
+
+    val = 0;
+    asm volatile("MCR p15, 0, %[r], c7, c5, 0" : : [r] "r"(val) : "memory");
+    asm volatile("MCR p15, 0, %[r], c7, c5, 6" : : [r] "r"(val) : "memory");
+    asm volatile("MCR p15, 0, %[r], c7, c10, 4" : : [r] "r"(val) : "memory");
+    asm volatile("MCR p15, 0, %[r], c7, c5, 4" : : [r] "r"(val) : "memory");
+
+    mycpu()->icachegen = gen;
 }
 
 static void _kpt_free(char *v)
@@ -210,6 +294,12 @@ int mappages(pde_t *pgdir, void *va, uint size, uint pa, int ap)
 
         *pte = pa | ((ap & 0x3) << 4) | PE_CACHE | PE_BUF | PTE_TYPE;
 
+        // user pages belong to one address space
+        if ((uint)a < UADDR_SZ)
+        {
+            *pte |= PTE_NG;
+        }
+
         if (a == last)
         {
             break;
@@ -233,10 +323,47 @@ static void flush_tlb(void)
     asm("MCR p15,0,%[r],c7,c11,0" : : [r] "r"(val) :);
 }
 
-// Switch to the user page table (TTBR0)
+// Return the ASID of address space as (its main thread), allocating one
+// if it has none from the current generation. Flushes the TLB of this
+// CPU if it has not seen the current generation yet.
+static uint asid_get(struct proc *as)
+{
+    acquire(&asid.lock);
+
+    if ((as->asid ^ asid.next) >> ASID_BITS)
+    {
+        // a new address space has been on no CPU. An old one keeps its
+        // CPUs: they may still run it under the old ASID.
+        if (as->asid == 0)
+        {
+            as->tlbcpus = 0;
+        }
+
+        if ((asid.next & ASID_MASK) == 0)
+        {
+            asid.next++;
+        }
+
+        as->asid = asid.next++;
+    }
+
+    as->tlbcpus |= 1 << mycpu()->id;
+
+    if ((mycpu()->asidgen ^ as->asid) >> ASID_BITS)
+    {
+        flush_tlb();
+        mycpu()->asidgen = as->asid & ~ASID_MASK;
+    }
+
+    release(&asid.lock);
+
+    return as->asid & ASID_MASK;
+}
+
+// Switch to the user page table (TTBR0) and ASID of p
 void switchuvm(struct proc *p)
 {
-    uint val;
+    uint val, id;
 
     pushcli();
 
@@ -245,14 +372,241 @@ void switchuvm(struct proc *p)
         panic("switchuvm: no pgdir");
     }
 
+    id = asid_get(p->main_thread);
     val = (uint)V2P(p->pgdir) | 0x00;
 
+    icache_sync();
+
+    // the branch predictor is not tagged, flush it
+    asm("MCR p15, 0, %[v], c7, c5, 6" : : [v] "r"(0) :);
+    asm("MCR p15, 0, %[v], c7, c10, 4" : : [v] "r"(0) :);
+
     asm("MCR p15, 0, %[v], c2, c0, 0" : : [v] "r"(val) :);
-    flush_tlb();
+    asm("MCR p15, 0, %[v], c13, c0, 1" : : [v] "r"(id) :);
+
+    mycpu()->pgdir = p->pgdir;
 
     popcli();
 }
 
+// Wait for the TLB invalidations so far to complete (DSB), then flush
+// the prefetch buffer so no instruction fetched through a dropped
+// entry runs.
+static void tlb_sync(void)
+{
+    uint val = 0;
+
+    asm volatile("MCR p15, 0, %[r], c7, c10, 4" : : [r] "r"(val) : "memory");
+    asm volatile("MCR p15, 0, %[r], c7, c5, 4" : : [r] "r"(val) : "memory");
+}
+
+// Drop the TLB entries of ASID id (with generation) on this CPU, or all
+// of them if the CPU may run it under another generation's ASID.
+static void tlb_dropasid(uint id)
+{
+    if ((mycpu()->asidgen ^ id) >> ASID_BITS)
+    {
+        asm volatile("MCR p15, 0, %[v], c8, c7, 0" : : [v] "r"(0) : "memory");
+    }
+    else
+    {
+        id &= ASID_MASK;
+        asm volatile("MCR p15, 0, %[v], c8, c7, 2" : : [v] "r"(id) : "memory");
+    }
+}
+
+// Drop the TLB entries of the page at va in ASID id on this CPU, like
+// tlb_dropasid.
+static void tlb_droppage(uint id, uint va)
+{
+    if ((mycpu()->asidgen ^ id) >> ASID_BITS)
+    {
+        asm volatile("MCR p15, 0, %[v], c8, c7, 0" : : [v] "r"(0) : "memory");
+    }
+    else
+    {
+        va = align_dn(va, PTE_SZ) | (id & ASID_MASK);
+        asm volatile("MCR p15, 0, %[v], c8, c7, 1" : : [v] "r"(va) : "memory");
+    }
+}
+
+// TLB shootdown: the other CPUs running (or that ran) an address space
+// keep their own TLB entries of it. To drop them, the sender writes the
+// ASID into its slot of each such CPU's tlbshoot, interrupts them, and
+// waits for each to clear the slot once its entries are gone. The slots
+// are per sender, so shootdowns from several CPUs proceed at the same
+// time, and a sender serves the requests to itself while it waits.
+// Callers must hold no spinlock another CPU may be spinning on with
+// interrupts off, or it could never answer.
+static void tlb_serve(void)
+{
+    struct cpu *c;
+    uint id;
+    int i, done;
+
+    c = mycpu();
+    done = 0;
+
+    for (i = 0; i < ncpu; i++)
+    {
+        if ((id = c->tlbshoot[i]) != 0)
+        {
+            tlb_dropasid(id);
+            done |= 1 << i;
+        }
+    }
+
+    if (done == 0)
+    {
+        return;
+    }
+
+    tlb_sync();
+    icache_sync();
+
+    for (i = 0; i < ncpu; i++)
+    {
+        if (done & (1 << i))
+        {
+            c->tlbshoot[i] = 0;
+        }
+    }
+}
+
+#ifdef IPI_TLB
+static void isr_tlb(struct trapframe *tf, int n)
+{
+    tlb_serve();
+}
+#endif
+
+void tlb_init(void)
+{
+#ifdef IPI_TLB
+    pic_enable(IPI_TLB, isr_tlb);
+#endif
+}
+
+// Drop the TLB entries of p's address space on every other CPU that may
+// hold them, and return once they are gone: only then may the pages
+// they mapped be reused.
+static void tlb_shootdown(struct proc *p)
+{
+#ifdef IPI_TLB
+    struct proc *as;
+    uint id, mask;
+    int me, i;
+
+    as = p->main_thread;
+    id = as->asid;
+
+    if (id == 0 || ncpu == 1)
+    {
+        return;
+    }
+
+    pushcli();
+
+    me = mycpu()->id;
+
+    // a CPU sets its bit before it loads the ASID, so one that is not in
+    // the mask holds nothing of the changes made before we read it
+    asm volatile("MCR p15, 0, %[r], c7, c10, 5" : : [r] "r"(0) : "memory");
+    mask = as->tlbcpus & ~(1 << me);
+
+    if (mask != 0)
+    {
+        for (i = 0; i < ncpu; i++)
+        {
+            if (mask & (1 << i))
+            {
+                cpus[i].tlbshoot[me] = id;
+            }
+        }
+
+        // the requests must be in memory before the interrupt arrives
+        asm volatile("MCR p15, 0, %[r], c7, c10, 4" : : [r] "r"(0) : "memory");
+        pic_sendipi(IPI_TLB);
+
+        for (i = 0; i < ncpu; i++)
+        {
+            while (cpus[i].tlbshoot[me] != 0)
+            {
+                tlb_serve();
+            }
+        }
+    }
+
+    popcli();
+#endif
+}
+
+// Make changes to p's page table visible on every CPU: drop the TLB
+// entries tagged with the ASID of its address space.
+void flushuvm(struct proc *p)
+{
+    uint id;
+
+    id = p->main_thread->asid;
+
+    if (id != 0)
+    {
+        tlb_dropasid(id);
+        tlb_sync();
+        tlb_shootdown(p);
+    }
+}
+
+// Drop the TLB entry of the user page at va in p's address space.
+// ARM does not keep faulting translations in the TLB, so an entry
+// only needs to go when a valid one is changed or removed.
+void flushupage(struct proc *p, uint va)
+{
+    uint id;
+
+    id = p->main_thread->asid;
+
+    if (id != 0)
+    {
+        tlb_droppage(id, va);
+        tlb_sync();
+        tlb_shootdown(p);
+    }
+}
+
+// Drop the TLB entries of the user pages in [start, end). Above
+// TLB_RANGE_MAX pages it is cheaper to drop the whole ASID. The other
+// CPUs drop the whole ASID either way, it takes one request.
+#define TLB_RANGE_MAX   16
+
+void flushurange(struct proc *p, uint start, uint end)
+{
+    uint a, id;
+
+    start = align_dn(start, PTE_SZ);
+    end = align_up(end, PTE_SZ);
+    id = p->main_thread->asid;
+
+    if (end <= start || id == 0)
+    {
+        return;
+    }
+
+    if ((end - start) / PTE_SZ > TLB_RANGE_MAX)
+    {
+        flushuvm(p);
+        return;
+    }
+
+    for (a = start; a < end; a += PTE_SZ)
+    {
+        tlb_droppage(id, a);
+    }
+
+    tlb_sync();
+    tlb_shootdown(p);
+}
+
 // Load the initcode into address 0 of pgdir. sz must be less than a page.
 void inituvm(pde_t *pgdir, char *init, uint sz)
 {
@@ -267,6 +621,7 @@ void inituvm(pde_t *pgdir, char *init, uint sz)
     memset(mem, 0, PTE_SZ);
     mappages(pgdir, 0, PTE_SZ, v2p(mem), AP_KU);
     memmove(mem, init, sz);
+    cache_clean(mem, PTE_SZ);
 }
 
 // Load a program segment into pgdir.  addr must be page-aligned
@@ -303,6 +658,8 @@ int loaduvm(pde_t *pgdir, char *addr, struct inode *ip, uint offset, uint sz)
         {
             return -1;
         }
+
+        cache_clean(p2v(pa), n);
     }
 
     return 0;
@@ -387,6 +744,77 @@ int deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
     return newsz;
 }
 
+// Shrink the memory of p, which may be running on other CPUs (threads),
+// from oldsz to newsz like deallocuvm. The pages are unmapped and their
+// TLB entries dropped on every CPU before they are freed, a batch of at
+// most TLB_RANGE_MAX at a time. Must not be called with a spinlock held,
+// see tlb_shootdown. Returns the new process size.
+int shrinkuvm(struct proc *p, uint oldsz, uint newsz)
+{
+    char *pages[TLB_RANGE_MAX];
+    pte_t *pte;
+    uint a, start;
+    int n, i;
+
+    if (newsz >= oldsz)
+    {
+        return oldsz;
+    }
+
+    n = 0;
+    start = align_up(newsz, PTE_SZ);
+
+    for (a = start; a < oldsz; a += PTE_SZ)
+    {
+        pte = walkpgdir(p->pgdir, (char *)a, 0);
+
+        if (!pte)
+        {
+            // no page table here, skip to the next page directory entry
+            a = align_up(a + 1, PDE_SZ) - PTE_SZ;
+            continue;
+        }
+
+        if ((*pte & PE_TYPES) == 0)
+        {
+            continue;
+        }
+
+        if (PTE_ADDR(*pte) == 0)
+        {
+            panic("shrinkuvm");
+        }
+
+        pages[n++] = p2v(PTE_ADDR(*pte));
+        *pte = 0;
+
+        if (n == TLB_RANGE_MAX)
+        {
+            flushurange(p, start, a + PTE_SZ);
+
+            for (i = 0; i < n; i++)
+            {
+                free_page(pages[i]);
+            }
+
+            n = 0;
+            start = a + PTE_SZ;
+        }
+    }
+
+    if (n > 0)
+    {
+        flushurange(p, start, oldsz);
+
+        for (i = 0; i < n; i++)
+        {
+            free_page(pages[i]);
+        }
+    }
+
+    return newsz;
+}
+
 // Free a page table and all the physical memory pages
 // in the user part.
 void freevm(pde_t *pgdir)
@@ -413,10 +841,21 @@ void freevm(pde_t *pgdir)
     }
 
     kpt_free((char *)pgdir);
+
+    // the memory may come back as another page table, whose process
+    // must not inherit the TLB entries of this one
+    for (i = 0; i < NCPU; i++)
+    {
+        if (cpus[i].pgdir == pgdir)
+        {
+            cpus[i].pgdir = 0;
+        }
+    }
 }
 
 // Clear PTE_U on a page. Used to create an inaccessible page beneath
-// the user stack (to trap stack underflow).
+// the user stack (to trap stack underflow). exec does it on a page table
+// that has no ASID yet, so the TLB holds nothing to drop.
 void clearpteu(pde_t *pgdir, char *uva)
 {
     pte_t *pte;
@@ -469,6 +908,7 @@ pde_t *copyuvm(pde_t *pgdir, uint sz)
         }
 
         memmove(mem, (char *)p2v(pa), PTE_SZ);
+        cache_clean(mem, PTE_SZ);
 
         if (mappages(d, (void *)i, PTE_SZ, v2p(mem), ap) < 0)
         {